@@ -18,6 +18,7 @@
 
 #include "KeyDownListener.h"
 #include "../utils/logger.h"
+#include "../utils/accurateTime.h"
 #include <Windows.h>
 #include <vector>
 
@@ -28,11 +29,8 @@ KeyDownListener::~KeyDownListener() {
     _thread.join();
 }
 
-KeyEventCount KeyDownListener::pollKeyEventCount() {
-    KeyEventCount kc = {0};
-    kc.keyDown = _keyDownCount.exchange(0);
-    kc.keyUp = _keyUpCount.exchange(0);
-    return kc;
+bool KeyDownListener::popKeyEvent(KeyEvent *event) {
+    return _events.get(event, 1);
 }
 
 ////
@@ -147,6 +145,9 @@ void KeyDownListener::threadProc(KeyDownListener *p) {
         ///   with raw input API
         /// So while seemingly not-so-efficient and slow, looping all keys through GetAsyncKeyState
         /// is the most reliable way to get keyboard states
+        // One scan takes a few microseconds, so its transitions share a timestamp.
+        KeyEvent event;
+        event.time = accurateTime();
         for (int vKey = 0; vKey < 256; vKey++) {
             auto normalizedVK = normalizeKey(vKey);
             if (!isValidKey(normalizedVK)) continue;
@@ -155,12 +156,14 @@ void KeyDownListener::threadProc(KeyDownListener *p) {
             if (state) {
                 if (!_keyPressed[vKey]) {
                     _keyPressed[vKey] = true;
-                    if (!initialRun) p->_keyDownCount++;
+                    event.keyUp = false;
+                    if (!initialRun) p->_events.push(&event, 1);
                 }
             } else {
                 if (_keyPressed[vKey]) {
                     _keyPressed[vKey] = false;
-                    if (!initialRun) p->_keyUpCount++;
+                    event.keyUp = true;
+                    if (!initialRun) p->_events.push(&event, 1);
                 }
             }
         }
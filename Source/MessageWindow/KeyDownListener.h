@@ -21,11 +21,8 @@
 
 #include <thread>
 #include <atomic>
-
-struct KeyEventCount {
-    int keyDown;
-    int keyUp;
-};
+#include "../utils/RingBuffer.h"
+#include "../utils/KeyEvent.h"
 
 class KeyDownListener {
 public:
@@ -33,16 +30,18 @@ public:
 
     ~KeyDownListener();
 
-    KeyEventCount pollKeyEventCount();
+    /// Pops the oldest key transition, in the order they were seen. Call from one thread only.
+    bool popKeyEvent(KeyEvent *event);
 
 private:
+    static constexpr size_t kQueueSize = 1024;  // events beyond this are dropped until popped
+
     static void threadProc(KeyDownListener *p);
 
     const bool _cpuThrottle;
+    RingBuffer<KeyEvent, true> _events{kQueueSize};  // before _thread, which starts pushing right away
     std::thread _thread;
     volatile bool _killThread = false;
-    std::atomic<int> _keyDownCount{0};
-    std::atomic<int> _keyUpCount{0};
 };
 
 #endif //TRGKASIO_KEYDOWNLISTENER_H
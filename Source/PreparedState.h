@@ -68,6 +68,7 @@ private:
     std::vector<IMMDevicePtr> _pDeviceList;
 
     int _bufferIndex = 0;
+    // One int32 per frame fits every AsioSampleFormat; see _pref->asioSampleFormat for the layout.
     std::vector<std::vector<int32_t>> _buffers[2];
 
     ASIOTimeStamp _theSystemTime = {0, 0};
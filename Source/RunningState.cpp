@@ -30,9 +30,12 @@
 #include <timeapi.h>
 #include <mmsystem.h>
 #include <deque>
+#include <algorithm>
 
 #include "WASAPIOutput/WASAPIOutputEvent.h"
 #include "utils/accurateTime.h"
+#include "utils/SampleConvert.h"
+#include "utils/LookaheadLimiter.h"
 #include <tracy/Tracy.hpp>
 #include "res/resource.h"
 
@@ -43,12 +46,28 @@ extern HINSTANCE g_hInstDLL;
 const int INDEX_KEYDOWN = 0;
 const int INDEX_KEYUP = 1;
 
+// Seconds between ring fill level reports. Counters restart after each report.
+const double ringFillStatsInterval = 60;
+
+// The limiter runs on the float bus, so it turns the float bus on.
+static bool usesFloatMixBus(const UserPref &pref) {
+    return pref.floatMixBus || pref.limiter;
+}
+
+// Seconds from key press to clap onset. By default one ASIO buffer, the
+// shortest latency at which claps don't have to start late.
+static double clapLatencyOf(const PreparedState *p) {
+    if (p->_pref->clapLatency >= 0) return p->_pref->clapLatency / 1000;
+    return (double) p->_bufferSize / p->_sampleRate;
+}
+
 RunningState::RunningState(PreparedState *p)
         : _preparedState(p),
           _clapRenderer(g_hInstDLL, {
-                          MAKEINTRESOURCE(IDR_CLAP_K70_KEYDOWN),
-                          MAKEINTRESOURCE(IDR_CLAP_K70_KEYUP)
-          }, p->_sampleRate),
+                          {MAKEINTRESOURCE(IDR_CLAP_K70_KEYDOWN), L"keydown.wav"},
+                          {MAKEINTRESOURCE(IDR_CLAP_K70_KEYUP), L"keyup.wav"}
+          }, p->_sampleRate, p->_pref->clapPack, usesFloatMixBus(*p->_pref)),
+          _clapScheduler(p->_sampleRate, clapLatencyOf(p)),
           _throttle(p->_pref->throttle),
           _keyListener(_throttle) {
     ZoneScoped;
@@ -56,6 +75,13 @@ RunningState::RunningState(PreparedState *p)
 
     auto driverSettings = p->_pref;
 
+    double bufferMs = 1000.0 * p->_bufferSize / p->_sampleRate;
+    if (driverSettings->clapLatency >= 0 && driverSettings->clapLatency < bufferMs) {
+        mainlog->warn("clapLatency {}ms is shorter than one ASIO buffer ({:.1f}ms), claps may start late",
+                      driverSettings->clapLatency, bufferMs);
+    }
+    mainlog->info("Clap latency {:.1f}ms", _clapScheduler.latency() * 1000);
+
     for (int i = 0; i < p->_pDeviceList.size(); i++) {
         auto &device = p->_pDeviceList[i];
         auto mode = (i == 0) ? WASAPIMode::Exclusive : WASAPIMode::Shared;
@@ -80,13 +106,65 @@ RunningState::RunningState(PreparedState *p)
         _outputList.push_back(std::move(output));
     }
 
+    // Gain and mute are keyed by endpoint ID; a friendly name silently does nothing.
+    auto warnUnmatched = [this](const wchar_t *prefName, const std::wstring &deviceId) {
+        bool matched = std::any_of(_outputList.begin(), _outputList.end(), [&](const auto &output) {
+            return output->getDeviceId() == deviceId;
+        });
+        if (!matched) {
+            mainlog->warn(L"{} key \"{}\" matches no opened output endpoint ID, ignoring", prefName, deviceId);
+        }
+    };
+    for (const auto &p: driverSettings->outputGain) warnUnmatched(L"outputGain", p.first);
+    for (const auto &p: driverSettings->outputMute) warnUnmatched(L"outputMute", p.first);
+
+    // Every output reads the same mixed samples from one shared ring.
+    std::vector<RingReaderConfig> readerConfigs;
+    for (const auto &output: _outputList) {
+        readerConfigs.push_back(output->getRingReaderConfig());
+    }
+    _outputRing = std::make_shared<OutputRingBuffer>(
+            driverSettings->channelCount,
+            readerConfigs,
+            RingBufferStorage::Mirrored);
+    if (!_outputRing->isMirrored()) {
+        mainlog->info("Mirrored ring buffer not available, using heap storage");
+    }
+    for (size_t i = 0; i < _outputList.size(); i++) {
+        _outputList[i]->start(OutputRingReader(_outputRing, i));
+    }
+
     _pollThread = std::thread(RunningState::threadProc, this);
+    _statsThread = std::thread(RunningState::statsThreadProc, this);
 }
 
 RunningState::~RunningState() {
     ZoneScoped;
     signalStop();
     _pollThread.join();
+    _statsThread.join();
+    logRingFillStats(false);
+}
+
+void RunningState::logRingFillStats(bool reset) {
+    ZoneScoped;
+    for (const auto &output: _outputList) {
+        auto &stats = output->getRingFillStats();
+        auto snapshot = stats.snapshot();
+        if (reset) stats.reset();
+        if (snapshot.samples == 0) continue;
+
+        // One count per 1/16 of the ring limit, lowest fill first.
+        std::wstring histogram;
+        for (auto count: snapshot.histogram) {
+            if (!histogram.empty()) histogram += L' ';
+            histogram += std::to_wstring(count);
+        }
+        mainlog->info(L"{} Ring fill: {} samples, low {} high {} mean {:.1f} of limit {}, histogram [{}], "
+                      L"{} blocks concealed",
+                      output->getDeviceId(), snapshot.samples, snapshot.low, snapshot.high, snapshot.mean(),
+                      stats.maxFill(), histogram, output->getConcealedBlocks());
+    }
 }
 
 void RunningState::signalOutputReady() {
@@ -109,38 +187,36 @@ void RunningState::signalStop() {
         mainlog->trace("[RunningState::signalStop] unlocking mutex");
     }
     _notifier.notify_all();
+    {
+        std::lock_guard lock(_statsMutex);
+        _statsStop = true;
+    }
+    _statsNotifier.notify_all();
+}
+
+// Logs ring fill stats off the MMCSS-boosted poll thread, which only records them.
+void RunningState::statsThreadProc(RunningState *state) {
+    auto interval = std::chrono::duration<double>(ringFillStatsInterval);
+    std::unique_lock lock(state->_statsMutex);
+    while (!state->_statsNotifier.wait_for(lock, interval, [state]() { return state->_statsStop; })) {
+        lock.unlock();
+        state->logRingFillStats(true);
+        lock.lock();
+    }
 }
 
 void compress24bitTo32bit(std::vector<std::vector<int32_t>> *outputBuffer) {
     ZoneScoped;
+    for (auto &channelBuffer: *outputBuffer) {
+        softClipInt24ToInt32(channelBuffer.data(), channelBuffer.size());
+    }
+}
 
-    const int32_t overflowPreventer = 5;
-    const int32_t compressPadding = (1 << 19) - overflowPreventer;
-    const int32_t compressionThresholdHigh =
-            (1 << 23) - compressPadding - overflowPreventer;
-    const int32_t compressionThresholdLow = -compressionThresholdHigh;
-
-    const auto channelCount = outputBuffer->size();
-    const auto bufferSize = outputBuffer->at(0).size();
-
-    for (size_t ch = 0; ch < channelCount; ch++) {
-        auto &channelBuffer = outputBuffer->at(ch);
-        for (size_t i = 0; i < bufferSize; i++) {
-            auto sample = channelBuffer[i];
-            int32_t o;
-            if (sample > compressionThresholdHigh) {
-                auto overflow = sample - compressionThresholdHigh;
-                o = compressionThresholdHigh + (int32_t) round(
-                        compressPadding * (2 / (1 + exp(-overflow / compressPadding)) - 1));
-            } else if (sample < compressionThresholdLow) {
-                auto overflow = sample - compressionThresholdLow;
-                o = compressionThresholdLow + (int32_t) round(
-                        compressPadding * (2 / (1 + exp(-overflow / compressPadding)) - 1));
-            } else {
-                o = sample;
-            }
-            channelBuffer[i] = (o << 8);
-        }
+void compressFloatTo32bit(const std::vector<std::vector<float>> &mixBuffer,
+                          std::vector<std::vector<int32_t>> *outputBuffer) {
+    ZoneScoped;
+    for (size_t ch = 0; ch < mixBuffer.size(); ch++) {
+        softClipFloatToInt32(mixBuffer[ch].data(), (*outputBuffer)[ch].data(), mixBuffer[ch].size());
     }
 }
 
@@ -155,6 +231,24 @@ void RunningState::threadProc(RunningState *state) {
         buf.resize(preparedState->_bufferSize);
     }
 
+    // Float mix bus: ASIO input and claps are mixed here, then clipped into outputBuffer.
+    bool floatMixBus = usesFloatMixBus(*preparedState->_pref);
+    auto asioSampleFormat = preparedState->_pref->asioSampleFormat;
+    std::vector<std::vector<float>> mixBuffer;
+    if (floatMixBus) {
+        mainlog->info("Using float mix bus");
+        mixBuffer.resize(channelCount);
+        for (auto &buf: mixBuffer) {
+            buf.resize(bufferSize);
+        }
+    }
+    std::unique_ptr<LookaheadLimiter> limiter;
+    if (preparedState->_pref->limiter) {
+        limiter = std::make_unique<LookaheadLimiter>(
+                channelCount, preparedState->_sampleRate, preparedState->_pref->limiterLookahead, bufferSize);
+        mainlog->info("Using lookahead limiter, latency {} frames", limiter->latency());
+    }
+
     // Ask MMCSS to temporarily boost the runThread priority
     // to reduce the possibility of glitches while we play.
     DWORD taskIndex = 0;
@@ -166,59 +260,13 @@ void RunningState::threadProc(RunningState *state) {
     mainlog->info("timeBeginPeriod({})", tcaps.wPeriodMin);
 
     double lastPollTime = accurateTime();
+    std::vector<bool> outputDetached(state->_outputList.size());
     double pollInterval = (double) preparedState->_bufferSize / preparedState->_sampleRate;
     bool shouldPoll = true;
 
-    const int clapQueueSize = 256;
-    const int maxConcurrentKeyCount = 16;
-    struct KeyDownPair {
-        double time = 0;
-        int eventId[maxConcurrentKeyCount + 1];  // +1 so that last element is always -1
-
-        KeyDownPair() {
-            std::fill(eventId, eventId + maxConcurrentKeyCount, -1);
-        }
-    };
-
-    // Fixed-size looping queue
-    // This is intentionally designed to overflow after keyDownQueueSize
-    // to prevent additional allocation
-    std::vector<KeyDownPair> clapQueue(clapQueueSize);
-    int clapQueueIndex = 0;
-
     while (true) {
         auto currentTime = accurateTime();
 
-        // TODO: put this block somewhere appropriate
-        {
-            ZoneScopedN("RunningState::threadProc - Keydown queue update");
-            // Update keydown queue for clap sound
-            auto pressCount = state->_keyListener.pollKeyEventCount();
-            if (pressCount.keyDown > 0 || pressCount.keyUp) {
-                auto &entry = clapQueue[clapQueueIndex];
-                int j = 0;
-
-                entry.time = currentTime;
-                for (int i = 0; i < pressCount.keyDown && j < maxConcurrentKeyCount; i++) {
-                    entry.eventId[j++] = INDEX_KEYDOWN;
-                }
-                for (int i = 0; i < pressCount.keyUp && j < maxConcurrentKeyCount; i++) {
-                    entry.eventId[j++] = INDEX_KEYUP;
-                }
-                entry.eventId[j] = -1;
-                clapQueueIndex = (clapQueueIndex + 1) % clapQueueSize;
-            }
-
-            // GC old keydown events
-            double cutoffTime = currentTime - state->_clapRenderer.getMaxClapSoundLength();
-            for (int i = 0; i < clapQueueSize; i++) {
-                if (clapQueue[i].eventId[0] >= 0 && clapQueue[i].time < cutoffTime) {
-                    clapQueue[i].eventId[0] = -1;
-                }
-            }
-        }
-
-
         mainlog->trace("[RunningState::threadProc] Locking mutex");
         std::unique_lock lock(state->_mutex);
 
@@ -251,11 +299,13 @@ void RunningState::threadProc(RunningState *state) {
                                currentAsioBufferIndex);
                 const auto &asioCurrentBuffer = preparedState->_buffers[currentAsioBufferIndex];
                 for (size_t ch = 0; ch < channelCount; ch++) {
-                    for (size_t i = 0; i < bufferSize; i++) {
-                        int32_t sample = asioCurrentBuffer[ch][i];
-                        sample >>= 8;  // Scale 32bit to 24bit (To prevent overflow in later steps)`
-                        sample -= (sample >> 4);  // multiply 15/16 ( = 0.9375 ) for later compression
-                        outputBuffer[ch][i] = sample;
+                    // Scale to 24bit (or float) with 15/16 headroom for later compression
+                    if (floatMixBus) {
+                        convertAsioToMixFloat(asioSampleFormat, asioCurrentBuffer[ch].data(), mixBuffer[ch].data(),
+                                              bufferSize);
+                    } else {
+                        convertAsioToMix(asioSampleFormat, asioCurrentBuffer[ch].data(), outputBuffer[ch].data(),
+                                         bufferSize);
                     }
                 }
                 mainlog->debug("[RunningState::threadProc] Switching to buffer {}", 1 - currentAsioBufferIndex);
@@ -266,34 +316,51 @@ void RunningState::threadProc(RunningState *state) {
             // Add clap sound
             {
                 ZoneScopedN("[RunningState::threadProc] _shouldPoll - Add clap sound");
-                for (int i = 0; i < clapQueueSize; i++) {
-                    auto &pair = clapQueue[i];
-                    if (pair.eventId[0] >= 0) {
-                        for (size_t ch = 0; ch < channelCount; ch++) {
-                            for (auto eventId: pair.eventId) {
-                                if (eventId == -1) break;
-                                state->_clapRenderer.render(
-                                        &outputBuffer[ch],
-                                        currentTime,
-                                        pair.time,
-                                        eventId,
-                                        preparedState->_pref->clapGain);
-                            }
-                        }
-                    }
+                auto &scheduler = state->_clapScheduler;
+                auto blockStart = scheduler.beginBlock(accurateTime(), bufferSize);
+                KeyEvent event;
+                while (state->_keyListener.popKeyEvent(&event)) {
+                    state->_clapRenderer.trigger(event.keyUp ? INDEX_KEYUP : INDEX_KEYDOWN,
+                                                 scheduler.onsetSample(event.time));
+                }
+                if (floatMixBus) {
+                    state->_clapRenderer.render(&mixBuffer, blockStart, preparedState->_pref->clapGain);
+                } else {
+                    state->_clapRenderer.render(&outputBuffer, blockStart, preparedState->_pref->clapGain);
                 }
             }
 
             // TODO: add additional processing
 
             // Rescale & compress output
-            compress24bitTo32bit(&outputBuffer);
+            if (limiter) {
+                ZoneScopedN("[RunningState::threadProc] _shouldPoll - Limiter");
+                limiter->process(&mixBuffer);
+            }
+            if (floatMixBus) compressFloatTo32bit(mixBuffer, &outputBuffer);
+            else compress24bitTo32bit(&outputBuffer);
 
             // Output
             {
                 ZoneScopedN("[RunningState::threadProc] _shouldPoll - Pushing outputs");
-                for (auto &output: state->_outputList) {
-                    output->pushSamples(outputBuffer);
+                auto &ring = state->_outputRing;
+                mainlog->trace("[RunningState::threadProc] Pushing outputs, wp {} ringSize {} maxSize {}",
+                               ring->wp(), ring->capacity(), ring->maxSize());
+                if (!ring->pushPlanar(outputBuffer)) {
+                    mainlog->warn("[++++++++++] Write overflow!");
+                }
+                for (size_t i = 0; i < state->_outputList.size(); i++) {
+                    state->_outputList[i]->getRingFillStats().record(ring->size(i));
+                    bool detached = ring->isDetached(i);
+                    if (detached != outputDetached[i]) {
+                        outputDetached[i] = detached;
+                        if (detached) {
+                            mainlog->warn(L"{} stopped reading, dropping its oldest frames",
+                                          state->_outputList[i]->getDeviceId());
+                        } else {
+                            mainlog->info(L"{} reading again", state->_outputList[i]->getDeviceId());
+                        }
+                    }
                 }
             }
         } else {
@@ -29,6 +29,7 @@
 #include "MessageWindow/MessageWindow.h"
 #include "WASAPIOutput/ClapRenderer.h"
 #include "MessageWindow/KeyDownListener.h"
+#include "utils/ClapScheduler.h"
 #include <atomic>
 #include <thread>
 #include <mutex>
@@ -46,6 +47,8 @@ public:
 private:
     void signalStop();
 
+    void logRingFillStats(bool reset);
+
     bool _throttle;
 
     PreparedState *_preparedState;
@@ -56,12 +59,21 @@ private:
     std::condition_variable_any _notifier;
     std::thread _pollThread;
 
+    std::mutex _statsMutex;
+    std::condition_variable _statsNotifier;
+    bool _statsStop = false;
+    std::thread _statsThread;
+
     std::vector<WASAPIOutputPtr> _outputList;
+    std::shared_ptr<OutputRingBuffer> _outputRing;
     ClapRenderer _clapRenderer;
+    ClapScheduler _clapScheduler;  // poll thread only
     MessageWindow _msgWindow;
     KeyDownListener _keyListener;
 
     static void threadProc(RunningState *state);
+
+    static void statsThreadProc(RunningState *state);
 };
 
 #endif //TRGKASIO_RUNNINGSTATE_H
@@ -28,12 +28,24 @@
 #include "PreparedState.h"
 #include "utils/logger.h"
 #include "utils/hexdump.h"
+#include "utils/LookaheadLimiter.h"
 #include <tracy/Tracy.hpp>
 
 
 using json = nlohmann::json;
 
-static const ASIOSampleType sampleType = ASIOSTInt32LSB;
+static ASIOSampleType toASIOSampleType(AsioSampleFormat format) {
+    switch (format) {
+        case AsioSampleFormat::Float32LSB:
+            return ASIOSTFloat32LSB;
+        case AsioSampleFormat::Int24LSB:
+            return ASIOSTInt24LSB;
+        case AsioSampleFormat::Int16LSB:
+            return ASIOSTInt16LSB;
+        default:
+            return ASIOSTInt32LSB;
+    }
+}
 
 TrgkASIOImpl::TrgkASIOImpl(void *sysRef)
         : _pref(loadUserPref()) {
@@ -183,7 +195,7 @@ ASIOError TrgkASIOImpl::getChannelInfo(ASIOChannelInfo *info) {
     if (info->isInput) return ASE_InvalidParameter;
     if (info->channel < 0 || info->channel >= _pref->channelCount) return ASE_InvalidParameter;
 
-    info->type = sampleType;
+    info->type = toASIOSampleType(_pref->asioSampleFormat);
     info->channelGroup = 0;
     info->isActive = _preparedState ? ASIOTrue : ASIOFalse;
 
@@ -278,7 +290,10 @@ ASIOError TrgkASIOImpl::getLatencies(long *_inputLatency, long *_outputLatency)
         return ASE_NotPresent;
     if (_inputLatency)
         *_inputLatency = _bufferSize;
-    if (_outputLatency)
+    if (_outputLatency) {
         *_outputLatency = 2 * _bufferSize;
+        if (_pref->limiter)
+            *_outputLatency += (long) LookaheadLimiter::latencyFrames(_sampleRate, _pref->limiterLookahead);
+    }
     return ASE_OK;
 }
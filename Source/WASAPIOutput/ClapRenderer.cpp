@@ -21,66 +21,145 @@
 #include "../res/resource.h"
 #include "../utils/logger.h"
 #include "../utils/WaveLoad.h"
+#include "../utils/SampleConvert.h"
+#include "../utils/ClapSoundCache.h"
+#include "../utils/MappedFile.h"
+#include "../utils/homeDirFilePath.h"
 #include "../lib/r8brain_free_src/CDSPResampler.h"
 #include <tracy/Tracy.hpp>
 
 #include <vector>
 #include <mmsystem.h>
 
-/////// IDK the use case, but user MAY replace clap sound resource
-// with their own things...
+// Resampled clap sounds, in the home directory next to trgkASIO.json
+static const TCHAR *clapCacheDir = TEXT("trgkASIO_clapcache");
 
-WaveSound loadWaveResource(HMODULE hDLL, int targetSampleRate, const TCHAR *resName) {
+/// Decodes and resamples a WAV file, or reads the result of a previous start from `cache`.
+static WaveSound loadCachedWave(const ClapSoundCache &cache, const uint8_t *content, size_t size,
+                                int targetSampleRate) {
+    auto hash = clapContentHash(content, size);
+    WaveSound sound;
+    if (cache.read(hash, targetSampleRate, &sound)) {
+        mainlog->debug("clap sound {:016x} at {} Hz loaded from cache", hash, targetSampleRate);
+        return sound;
+    }
+
+    sound = loadWaveSound(content, size, targetSampleRate);
+    if (!cache.write(hash, targetSampleRate, sound)) {
+        mainlog->warn(L"Cannot write clap sound cache {}", cache.pathFor(hash, targetSampleRate).wstring());
+    }
+    return sound;
+}
+
+WaveSound loadWaveResource(HMODULE hDLL, const ClapSoundCache &cache, int targetSampleRate, const TCHAR *resName) {
     auto clapSoundWAV = loadUserdataResource(hDLL, resName);
-    return loadWaveSound(clapSoundWAV, targetSampleRate);
+    return loadCachedWave(cache, clapSoundWAV.data(), clapSoundWAV.size(), targetSampleRate);
 }
 
-ClapRenderer::ClapRenderer(HMODULE hDLL, const std::vector<LPCTSTR> &resList, int targetSampleRate) {
+/// Loads `source` from the clap pack folder, if it has it. Returns false to use the built-in sound instead.
+static bool loadPackWave(const std::filesystem::path &clapPack, const ClapSoundCache &cache, int targetSampleRate,
+                         const ClapSource &source, WaveSound *sound) {
+    auto path = clapPack / source.packFile;
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(path, ec)) {
+        mainlog->info(L"Clap pack has no {}, using the built-in sound", source.packFile);
+        return false;
+    }
+
+    auto file = MappedFile::open(path);
+    if (!file) {
+        mainlog->error(L"Cannot open clap sound {}, using the built-in sound", path.wstring());
+        return false;
+    }
     try {
-        double maxTime = 0;
-        for (auto resName: resList) {
-            auto res = loadWaveResource(hDLL, targetSampleRate, resName);
-            _clapSoundList.push_back(res);
-            double time = (double) res.audio.size() / (double) res.sampleRate;
-            if (time > maxTime) maxTime = time;
+        *sound = loadCachedWave(cache, file->data(), file->size(), targetSampleRate);
+    } catch (AppException &e) {
+        mainlog->error(L"Cannot load clap sound {}, using the built-in sound", path.wstring());
+        mainlog->error("{}", e.what());
+        return false;
+    }
+    mainlog->info(L"Clap sound {}", path.wstring());
+    return true;
+}
+
+ClapRenderer::ClapRenderer(HMODULE hDLL, const std::vector<ClapSource> &clapList, int targetSampleRate,
+                           const std::wstring &clapPack, bool floatMixBus) {
+    ClapSoundCache cache(homeDirFilePath(clapCacheDir));
+    // Relative to the home directory, like trgkASIO.json
+    auto packDir = std::filesystem::path(homeDirFilePath(TEXT(""))) / clapPack;
+    try {
+        for (const auto &source: clapList) {
+            WaveSound sound;
+            if (clapPack.empty() || !loadPackWave(packDir, cache, targetSampleRate, source, &sound)) {
+                sound = loadWaveResource(hDLL, cache, targetSampleRate, source.resource);
+            }
+            // float is plenty for a 24-bit bus, and half the size of the decoded doubles.
+            _clapSoundList.emplace_back(sound.audio.begin(), sound.audio.end());
         }
-        _maxClapSoundLength = maxTime;
     } catch (AppException &e) {
         mainlog->error("Cannot load clap sound: {}", e.what());
-        _maxClapSoundLength = 0;
         _clapSoundList.clear();
     }
+    if (floatMixBus) _clapTablesFloat.resize(_clapSoundList.size());
+    else _clapTables.resize(_clapSoundList.size());
 }
 
-double ClapRenderer::getMaxClapSoundLength() const {
-    return _maxClapSoundLength;
+void ClapRenderer::trigger(int index, int64_t startSample) {
+    if (!getClapSound(index)) return;
+    _voices.trigger(index, startSample);
 }
 
-void ClapRenderer::render(std::vector<int32_t> *output, double renderTime, double clapStartTime, int index,
-                          double gain) const {
+template<typename T>
+void ClapRenderer::mixVoices(std::vector<ClapTable<T>> *tables, std::vector<T> *clapMix, size_t frames,
+                             int64_t blockStart, double gain) {
+    // Cheap unless clapGain changed.
+    for (size_t i = 0; i < tables->size(); i++) {
+        (*tables)[i].bake(_clapSoundList[i], gain);
+    }
+
+    clapMix->assign(frames, 0);
+    _voices.render([&](const ClapVoice &voice) {
+        return (*tables)[voice.sound].mix(blockStart - voice.startSample, clapMix->data(), frames);
+    });
+}
+
+void ClapRenderer::render(std::vector<std::vector<int32_t>> *output, int64_t blockStart, double gain) {
     assert(output);
 
     ZoneScoped;
 
-    if (_clapSoundList.empty()) return;
+    if (_voices.size() == 0 || output->empty()) return;
 
-    if (index < 0 || index > _clapSoundList.size()) {
-        mainlog->warn("ClapRender::render called with OOB index {} (range: 0 ~ {})", index, _clapSoundList.size());
-        return;
+    assert(_clapTables.size() == _clapSoundList.size());
+    // Claps are mono: mix them once, then add the result to every channel.
+    size_t frames = output->front().size();
+    mixVoices(&_clapTables, &_clapMix, frames, blockStart, gain);
+    for (auto &channel: *output) {
+        mixAddInt32(_clapMix.data(), channel.data(), frames);
+    }
+}
+
+void ClapRenderer::render(std::vector<std::vector<float>> *output, int64_t blockStart, double gain) {
+    assert(output);
+
+    ZoneScoped;
+
+    if (_voices.size() == 0 || output->empty()) return;
+
+    assert(_clapTablesFloat.size() == _clapSoundList.size());
+    size_t frames = output->front().size();
+    mixVoices(&_clapTablesFloat, &_clapMixFloat, frames, blockStart, gain);
+    for (auto &channel: *output) {
+        mixAddFloat(_clapMixFloat.data(), channel.data(), frames);
     }
+}
+
+const std::vector<float> *ClapRenderer::getClapSound(int index) const {
+    if (_clapSoundList.empty()) return nullptr;
 
-    auto &clapSound = _clapSoundList[index];
-    double clapRelTime = (renderTime - clapStartTime);
-    int clapStartSamples = (int) round(clapRelTime * clapSound.sampleRate);
-    mainlog->trace("clapRelTime {}, clapStartSamples {}", clapRelTime, clapStartSamples);
-
-    // Clap hadn't started
-    const auto &samples = clapSound.audio;
-    int32_t *outP = output->data();
-    for (int i = std::max(0, -clapStartSamples); i < output->size(); i++) {
-        auto inPos = i + clapStartSamples;
-        if (inPos < 0) continue;
-        else if (inPos >= samples.size()) break;
-        outP[i] += (int32_t) round(samples[inPos] * gain * (1 << 24));
+    if (index < 0 || index >= _clapSoundList.size()) {
+        mainlog->warn("ClapRender::render called with OOB index {} (range: 0 ~ {})", index, _clapSoundList.size());
+        return nullptr;
     }
+    return &_clapSoundList[index];
 }
@@ -20,23 +20,58 @@
 #define TRGKASIO_CLAPRENDERER_H
 
 #include <Windows.h>
+#include <string>
 #include <vector>
 #include <random>
-#include "../utils/WaveLoad.h"
+#include "../utils/ClapVoicePool.h"
+#include "../utils/ClapTable.h"
+
+/// A clap sound: `packFile` in the clap pack folder, or the built-in `resource` if the pack doesn't have it.
+struct ClapSource {
+    LPCTSTR resource;
+    const wchar_t *packFile;
+};
 
 class ClapRenderer {
 public:
-    ClapRenderer(HMODULE hDLL, const std::vector<LPCTSTR> &clapList, int targetSampleRate);
+    /// Claps that can sound at once. More key presses replace the oldest.
+    static constexpr size_t kMaxVoices = 64;
+
+    /**
+     * `clapPack` is a folder of WAV files, or empty for the built-in sounds only.
+     * Only the `render` of the chosen mix bus may be called.
+     */
+    ClapRenderer(HMODULE hDLL, const std::vector<ClapSource> &clapList, int targetSampleRate,
+                 const std::wstring &clapPack, bool floatMixBus);
 
     ~ClapRenderer() = default;
 
-    double getMaxClapSoundLength() const;
+    /// Starts clap sound `index` at output sample `startSample` (see ClapScheduler).
+    void trigger(int index, int64_t startSample);
+
+    /// Adds every sounding clap to each channel of the block starting at output sample `blockStart`.
+    void render(std::vector<std::vector<int32_t>> *output, int64_t blockStart, double gain);
 
-    void render(std::vector<int32_t> *output, double renderTime, double clapStartTime, int index, double gain) const;
+    /// Same as above, for the float mix bus (1.0 is full scale).
+    void render(std::vector<std::vector<float>> *output, int64_t blockStart, double gain);
+
+    /// Claps sounding now.
+    [[nodiscard]] size_t activeVoices() const { return _voices.size(); }
 
 private:
-    std::vector<WaveSound> _clapSoundList;
-    double _maxClapSoundLength;
+    /// Bakes `tables` at `gain` and sets `clapMix` to the mono sum of the sounding claps over `frames`.
+    template<typename T>
+    void mixVoices(std::vector<ClapTable<T>> *tables, std::vector<T> *clapMix, size_t frames, int64_t blockStart,
+                   double gain);
+
+    const std::vector<float> *getClapSound(int index) const;
+
+    std::vector<std::vector<float>> _clapSoundList;  // resampled, kept to rebake when clapGain changes
+    std::vector<ClapTable<int32_t>> _clapTables;  // per sound, integer mix bus only
+    std::vector<ClapTable<float>> _clapTablesFloat;  // per sound, float mix bus only
+    ClapVoicePool _voices{kMaxVoices};
+    std::vector<int32_t> _clapMix;  // mono sum of the voices, one block
+    std::vector<float> _clapMixFloat;
 };
 
 #endif //TRGKASIO_CLAPRENDERER_H
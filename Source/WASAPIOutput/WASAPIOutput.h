@@ -23,16 +23,42 @@
 
 #include <vector>
 #include <memory>
+#include <string>
+#include "../utils/BroadcastRingBuffer.h"
+#include "../utils/RingFillStats.h"
+
+/// Mixed output, shared by every output. Frames are interleaved int32 samples.
+using OutputRingBuffer = BroadcastRingBuffer<int32_t>;
+using OutputRingReader = BroadcastRingReader<int32_t>;
 
 class WASAPIOutput {
 public:
     virtual ~WASAPIOutput() = default;
 
+    /// How much this output wants the shared ring to queue for it, and what to do on overflow.
+    virtual RingReaderConfig getRingReaderConfig() const = 0;
+
     /**
-     * Push samples to ring central queue. This will be printed to asio.
-     * @param buffer `sample = buffer[channel][sampleIndex]`
+     * Start playing. Samples are read from the shared output ring through `reader`.
      */
-    virtual void pushSamples(const std::vector<std::vector<int32_t>> &buffer) = 0;
+    virtual void start(OutputRingReader reader) = 0;
+
+    virtual const std::wstring &getDeviceId() const = 0;
+
+    /// Fill level of this output's queue in the shared ring, sampled on every read and write.
+    virtual RingFillStats &getRingFillStats() = 0;
+
+    /// Device buffers filled by underrun concealment instead of ring data.
+    virtual uint64_t getConcealedBlocks() const = 0;
+
+    /**
+     * Output level as a linear gain, and mute. May be called from any thread
+     * while playing; the play thread picks the values up on its next buffer
+     * and ramps to them.
+     */
+    virtual void setGain(float gain) = 0;
+
+    virtual void setMute(bool mute) = 0;
 };
 
 using WASAPIOutputPtr = std::shared_ptr<WASAPIOutput>;
@@ -21,7 +21,8 @@
 #include <Audioclient.h>
 #include <avrt.h>
 #include <cassert>
-#include <mutex>
+#include <cmath>
+#include <algorithm>
 #include <cstdlib>
 
 #include "WASAPIOutput.h"
@@ -32,9 +33,17 @@
 #include "../utils/raiiUtils.h"
 #include "../utils/logger.h"
 #include "../utils/AppException.h"
+#include "../utils/DeviceWriter.h"
 #include <tracy/Tracy.hpp>
 
 
+static DeviceSampleFormat getDeviceSampleFormat(const WAVEFORMATEXTENSIBLE &waveFormat) {
+    if (waveFormat.SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT) return DeviceSampleFormat::Float32;
+    if (waveFormat.Format.wBitsPerSample == 16) return DeviceSampleFormat::Int16;
+    if (waveFormat.Samples.wValidBitsPerSample == 24) return DeviceSampleFormat::Int24In32;
+    return DeviceSampleFormat::Int32;
+}
+
 WASAPIOutputEvent::WASAPIOutputEvent(
         const std::shared_ptr<IMMDevice> &pDevice,
         UserPrefPtr pref,
@@ -54,6 +63,15 @@ WASAPIOutputEvent::WASAPIOutputEvent(
         mainlog->error(L"{} Cannot find suitable stream for mat for output _pDevice", _pDeviceId);
         throw AppException("FindStreamFormat failed");
     }
+    // Seeded per device, so outputs sharing a signal get uncorrelated dither.
+    auto ditherSeed = (uint32_t) std::hash<std::wstring>()(_pDeviceId);
+    auto sampleFormat = getDeviceSampleFormat(_waveFormat);
+    _deviceWriter = DeviceWriter(sampleFormat, _channelNum, pref->dither, ditherSeed);
+    if (sampleFormat == DeviceSampleFormat::Int16) {
+        mainlog->info(L"{} WASAPIOutputEvent: - 16-bit output, dither {}", _pDeviceId,
+                      pref->dither == DitherMode::None ? L"none" :
+                      pref->dither == DitherMode::Tpdf ? L"tpdf" : L"shaped");
+    }
 
     hr = _pAudioClient->GetBufferSize(&_outputBufferSize);
     if (FAILED(hr)) {
@@ -62,15 +80,38 @@ WASAPIOutputEvent::WASAPIOutputEvent(
     mainlog->info(L"{} WASAPIOutputEvent: - Buffer size: input {}, output {}",
                   _pDeviceId, _inputBufferSize, _outputBufferSize);
 
-    size_t ringBufferSize = (_inputBufferSize + _outputBufferSize) * ringBufferSizeMultiplier;
-    for (int i = 0; i < _channelNum; i++) {
-        _ringBufferList.emplace_back(ringBufferSize);
+    if (pref->underrunConcealment) {
+        auto fadeFrames = std::max<size_t>(1, (size_t) (sampleRate * UnderrunConcealer::kFadeMs / 1000));
+        _concealer = std::make_unique<UnderrunConcealer>(_channelNum, _outputBufferSize, fadeFrames);
     }
 
-    _loadDataBuffer.resize(_outputBufferSize);
+    _ringReaderConfig.limit = (_inputBufferSize + _outputBufferSize) * ringBufferSizeMultiplier;
+    // Trimming keeps one input block and one device buffer queued.
+    _ringReaderConfig.trimTarget = _inputBufferSize + _outputBufferSize;
+    auto it = pref->overflowPolicy.find(_pDeviceId);
+    if (it != pref->overflowPolicy.end()) {
+        _ringReaderConfig.policy = it->second;
+    }
+    // A stopped or unplugged device must not silence the other outputs.
+    _ringReaderConfig.detachAfter = std::max<size_t>(
+            1, (size_t) (sampleRate * kStallDetachMs / 1000 / _inputBufferSize));
+    _deviceWriter.setGainRampFrames((size_t) (sampleRate * kGainRampMs / 1000));
+    auto gainIt = pref->outputGain.find(_pDeviceId);
+    if (gainIt != pref->outputGain.end()) {
+        setGain((float) std::pow(10.0, gainIt->second / 20));
+        mainlog->info(L"{} WASAPIOutputEvent: - Gain {:.1f}dB", _pDeviceId, gainIt->second);
+    }
+    auto muteIt = pref->outputMute.find(_pDeviceId);
+    if (muteIt != pref->outputMute.end() && muteIt->second) {
+        setMute(true);
+        mainlog->info(L"{} WASAPIOutputEvent: - Muted", _pDeviceId);
+    }
 
-    // TODO: start only when sufficient data is fetched.
-    start();
+    _ringFillStats.setMaxFill(_ringReaderConfig.limit);
+    mainlog->info(L"{} WASAPIOutputEvent: - Ring limit {}, overflow policy {}",
+                  _pDeviceId, _ringReaderConfig.limit,
+                  _ringReaderConfig.policy == RingOverflowPolicy::DropNewest ? L"dropNewest" :
+                  _ringReaderConfig.policy == RingOverflowPolicy::DropOldest ? L"dropOldest" : L"trim");
 }
 
 WASAPIOutputEvent::~WASAPIOutputEvent() {
@@ -80,12 +121,19 @@ WASAPIOutputEvent::~WASAPIOutputEvent() {
     WaitForSingleObject(_runningEvent, INFINITE);
 }
 
-void WASAPIOutputEvent::start() {
+void WASAPIOutputEvent::setGain(float gain) {
+    if (!(gain >= 0)) gain = 0;  // NaN too
+    _gain.store(std::min(gain, kMaxGain), std::memory_order_relaxed);
+}
+
+void WASAPIOutputEvent::start(OutputRingReader reader) {
     ZoneScoped;
 
     // Wait for previous wasapi thread to close
     WaitForSingleObject(_runningEvent, INFINITE);
     if (!_stopEvent) {
+        // TODO: start only when sufficient data is fetched.
+        _ringBuffer = std::make_unique<OutputRingReader>(std::move(reader));
         _stopEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
         CreateThread(nullptr, 0, playThread, this, 0, nullptr);
     }
@@ -102,57 +150,6 @@ void WASAPIOutputEvent::stop() {
 }
 
 
-void WASAPIOutputEvent::pushSamples(const std::vector<std::vector<int32_t>> &buffer) {
-    ZoneScoped;
-
-    assert (buffer.size() == _channelNum);
-
-    auto inputSize = buffer[0].size();
-
-    {
-        auto &rb0 = _ringBufferList[0];
-        mainlog->trace(L"{} pushSamples, rp {} wp {} _ringBufferSize {} _inputBufferSize {}, _outputBufferSize {}",
-                       _pDeviceId, rb0.rp(), rb0.wp(),
-                       rb0.capacity(), _inputBufferSize, _outputBufferSize);
-    }
-
-    {
-        ZoneScopedN("Validating argument buffer size");
-        if (buffer.size() != _channelNum) {
-            mainlog->error(L"{} Invalid channel count: expected {}, got {}", _pDeviceId, _channelNum, buffer.size());
-            return;
-        }
-
-        if (buffer[0].size() != _inputBufferSize) {
-            mainlog->error(L"{} Invalid chunk length: expected {}, got {}", _pDeviceId, _inputBufferSize,
-                           buffer[0].size());
-            return;
-        }
-    }
-
-    bool write_overflow = false;
-    {
-        ZoneScopedN("Buffer copying");
-
-        std::lock_guard guard(_ringBufferMutex);
-        if (_ringBufferList[0].size() + inputSize >= _ringBufferList[0].capacity()) {
-            write_overflow = true;
-        } else {
-            for (int ch = 0; ch < _channelNum; ch++) {
-                auto res = _ringBufferList[ch].push(buffer[ch].data(), inputSize);
-                assert(res);
-            }
-        }
-    }
-
-    // Logging may take long, so do this outside of the mutex
-    if (write_overflow) {
-        mainlog->warn(L"{} [++++++++++] Write overflow!", _pDeviceId);
-        return;
-    }
-}
-
-
 HRESULT WASAPIOutputEvent::LoadData(const std::shared_ptr<IAudioRenderClient> &pRenderClient) {
     if (!pRenderClient) {
         return E_INVALIDARG;
@@ -180,50 +177,47 @@ HRESULT WASAPIOutputEvent::LoadData(const std::shared_ptr<IAudioRenderClient> &p
         }
     }
 
-    UINT32 sampleSize = _waveFormat.Format.wBitsPerSample / 8;
-
-    {
-        auto &rb0 = _ringBufferList[0];
-        mainlog->debug(L"{} LoadData, rp {} wp {} ringSize {} get {}", _pDeviceId, rb0.rp(), rb0.wp(),
-                       rb0.capacity(), writeBufferSize);
-    }
+    mainlog->debug(L"{} LoadData, rp {} wp {} ringSize {} get {}", _pDeviceId, _ringBuffer->rp(), _ringBuffer->wp(),
+                   _ringBuffer->capacity(), writeBufferSize);
 
     bool skipped = false;
     {
         ZoneScopedN("Buffer copying");
 
-        std::lock_guard guard(_ringBufferMutex);
+        float gain = _mute.load(std::memory_order_relaxed) ? 0.0f : _gain.load(std::memory_order_relaxed);
 
-        if (_ringBufferList[0].size() < writeBufferSize) {
-            memset(pData, 0, sampleSize * _channelNum * writeBufferSize);
+        auto spans = _ringBuffer->readSpans();
+        _ringFillStats.record(spans.size());
+        if (spans.size() < writeBufferSize) {
+            if (_concealer) {
+                _deviceWriter.write(_concealer->conceal(writeBufferSize), writeBufferSize, pData, gain);
+            } else {
+                _deviceWriter.silence(writeBufferSize, pData);
+            }
+            _ringBuffer->commitRead(0);
             skipped = true;
         } else {
-            for (unsigned ch = 0; ch < _channelNum; ch++) {
-                _ringBufferList[ch].get(_loadDataBuffer.data(), writeBufferSize);
-                if (sampleSize == 2) {
-                    auto out = reinterpret_cast<int16_t *>(pData) + ch;
-                    auto pStart = _loadDataBuffer.data();
-                    auto pEnd = _loadDataBuffer.data() + writeBufferSize;
-                    for (auto p = pStart; p != pEnd; p++) {
-                        *out = (int16_t) ((*p) >> 16);
-                        out += _channelNum;
-                    }
-                } else if (sampleSize == 4) {
-                    auto out = reinterpret_cast<int32_t *>(pData) + ch;
-                    auto pStart = _loadDataBuffer.data();
-                    auto pEnd = _loadDataBuffer.data() + writeBufferSize;
-                    for (auto p = pStart; p != pEnd; p++) {
-                        *out = *p;
-                        out += _channelNum;
-                    }
-                }
-            }
+            // Convert straight from ring storage into the device buffer. The
+            // concealer only copies while fading in after an underrun.
+            if (_concealer) spans = _concealer->deliver(spans, writeBufferSize);
+            _deviceWriter.write(spans, writeBufferSize, pData, gain);
+            _ringBuffer->commitRead(writeBufferSize);
         }
     }
 
-    // mainlog->warn may take long, so this logging should be done outside _ringBufferMutex lock.
     if (skipped) {
-        mainlog->warn(L"{} [----------] Skipped pushing to wasapi", _pDeviceId);
+        if (_concealer) {
+            mainlog->warn(L"{} [----------] Underrun, concealed", _pDeviceId);
+        } else {
+            mainlog->warn(L"{} [----------] Skipped pushing to wasapi", _pDeviceId);
+        }
+    }
+
+    auto droppedFrames = _ringBuffer->droppedFrames();
+    if (droppedFrames != _reportedDroppedFrames) {
+        mainlog->warn(L"{} [>>>>>>>>>>] Overflow, dropped {} oldest frames", _pDeviceId,
+                      droppedFrames - _reportedDroppedFrames);
+        _reportedDroppedFrames = droppedFrames;
     }
 
     {
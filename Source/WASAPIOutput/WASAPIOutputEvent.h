@@ -24,18 +24,26 @@
 #include <mmdeviceapi.h>
 #include <Audioclient.h>
 
-#include <mutex>
 #include <memory>
 #include <vector>
 #include <functional>
 
+#include <atomic>
 #include "WASAPIOutput.h"
+#include "../utils/DeviceWriter.h"
+#include "../utils/UnderrunConcealer.h"
 #include <tracy/Tracy.hpp>
-#include "../utils/RingBuffer.h"
 #include "createIAudioClient.h"
 
 class WASAPIOutputEvent : public WASAPIOutput {
 public:
+    /// Length of the ramp to a new gain or mute.
+    static constexpr double kGainRampMs = 10;
+    /// +12dB
+    static constexpr float kMaxGain = 4;
+    /// A dropNewest output that rejects blocks for this long is detached from the ring.
+    static constexpr double kStallDetachMs = 200;
+
     WASAPIOutputEvent(
             const std::shared_ptr<IMMDevice> &pDevice,
             UserPrefPtr pref,
@@ -46,17 +54,23 @@ public:
 
     ~WASAPIOutputEvent();
 
-    /**
-     * Push samples to ring central queue. This will be printed to asio.
-     * @param buffer `sample = buffer[channel][sampleIndex]`
-     */
-    void pushSamples(const std::vector<std::vector<int32_t>> &buffer);
+    RingReaderConfig getRingReaderConfig() const override { return _ringReaderConfig; }
+
+    void start(OutputRingReader reader) override;
+
+    const std::wstring &getDeviceId() const override { return _pDeviceId; }
+
+    RingFillStats &getRingFillStats() override { return _ringFillStats; }
+
+    uint64_t getConcealedBlocks() const override { return _concealer ? _concealer->concealedBlocks() : 0; }
+
+    void setGain(float gain) override;
+
+    void setMute(bool mute) override { _mute.store(mute, std::memory_order_relaxed); }
 
     UINT32 getOutputBufferSize() const { return _outputBufferSize; }
 
 private:
-    void start();
-
     void stop();
 
     static DWORD WINAPI playThread(LPVOID pThis);
@@ -69,6 +83,9 @@ private:
     int _sampleRate;
     UINT32 _inputBufferSize;
     UINT32 _outputBufferSize;
+    RingReaderConfig _ringReaderConfig{0};
+    size_t _reportedDroppedFrames = 0;
+    RingFillStats _ringFillStats;
 
     WASAPIMode _mode;
 
@@ -76,10 +93,15 @@ private:
     std::shared_ptr<IAudioClient> _pAudioClient;
     std::wstring _pDeviceId;
     WAVEFORMATEXTENSIBLE _waveFormat{};
+    DeviceWriter _deviceWriter;
+    std::unique_ptr<UnderrunConcealer> _concealer;  // null: underruns are silence
+
+    // Written by any thread, read by the play thread.
+    std::atomic<float> _gain{1};
+    std::atomic<bool> _mute{false};
+    static_assert(std::atomic<float>::is_always_lock_free);
 
-    std::vector<RingBuffer<int32_t>> _ringBufferList;
-    std::mutex _ringBufferMutex;
-    std::vector<int32_t> _loadDataBuffer;
+    std::unique_ptr<OutputRingReader> _ringBuffer;
 
     HANDLE _stopEvent = nullptr;
     HANDLE _runningEvent = nullptr;
@@ -168,8 +168,6 @@ bool FindStreamFormat(
     DWORD dwChannelMask = (1 << channelCount) - 1;
     WAVEFORMATEXTENSIBLE waveFormat = {0};
 
-    //try 32-bit first
-    mainlog->debug(TEXT("{} triyng 32bit"), deviceId);
     waveFormat.Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
     waveFormat.Format.nChannels = channelCount;
     waveFormat.Format.nSamplesPerSec = sampleRate;
@@ -179,9 +177,22 @@ bool FindStreamFormat(
     waveFormat.Format.cbSize = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX);
     waveFormat.Samples.wValidBitsPerSample = waveFormat.Format.wBitsPerSample;
     waveFormat.dwChannelMask = dwChannelMask;
-    waveFormat.SubFormat = KSDATAFORMAT_SUBTYPE_PCM;
 
-    auto pAudioClient = createAudioClient(pref, pDevice, (WAVEFORMATEX *) &waveFormat, mode);
+    std::shared_ptr<IAudioClient> pAudioClient;
+
+    // The shared mode engine mixes in float, so float skips a conversion there.
+    // Exclusive mode hardware is integer, so keep the integer formats first.
+    if (mode == WASAPIMode::Shared) {
+        mainlog->debug(TEXT("{} triyng 32bit float"), deviceId);
+        waveFormat.SubFormat = KSDATAFORMAT_SUBTYPE_IEEE_FLOAT;
+        pAudioClient = createAudioClient(pref, pDevice, (WAVEFORMATEX *) &waveFormat, mode);
+        if (pAudioClient) goto Finish;
+    }
+
+    //try 32-bit next
+    mainlog->debug(TEXT("{} triyng 32bit"), deviceId);
+    waveFormat.SubFormat = KSDATAFORMAT_SUBTYPE_PCM;
+    pAudioClient = createAudioClient(pref, pDevice, (WAVEFORMATEX *) &waveFormat, mode);
     if (pAudioClient) goto Finish;
 
     //try 24-bit-in-32bit next
@@ -27,6 +27,25 @@
 
 using json = nlohmann::json;
 
+static const std::pair<const char *, RingOverflowPolicy> overflowPolicyNames[] = {
+        {"dropNewest", RingOverflowPolicy::DropNewest},
+        {"dropOldest", RingOverflowPolicy::DropOldest},
+        {"trim",       RingOverflowPolicy::Trim},
+};
+
+static const std::pair<const char *, AsioSampleFormat> asioSampleFormatNames[] = {
+        {"int32",   AsioSampleFormat::Int32LSB},
+        {"float32", AsioSampleFormat::Float32LSB},
+        {"int24",   AsioSampleFormat::Int24LSB},
+        {"int16",   AsioSampleFormat::Int16LSB},
+};
+
+static const std::pair<const char *, DitherMode> ditherModeNames[] = {
+        {"none",   DitherMode::None},
+        {"tpdf",   DitherMode::Tpdf},
+        {"shaped", DitherMode::Shaped},
+};
+
 const wchar_t *defaultDevices[] = {
         L"(default)",
         L"CABLE Input(VB-Audio Virtual Cable)",
@@ -50,7 +69,41 @@ UserPrefPtr loadUserPref(LPCTSTR loadRelPath) {
 
         ret->channelCount = j.value("channelCount", 2);
         ret->clapGain = j.value("clapGain", 0.);
+        ret->clapLatency = j.value("clapLatency", -1.);
+        ret->clapPack = utf8_to_wstring(j.value("clapPack", ""));
         ret->throttle = j.value("throttle", true);
+        ret->floatMixBus = j.value("floatMixBus", false);
+        ret->limiter = j.value("limiter", false);
+        ret->limiterLookahead = j.value("limiterLookahead", 1.0);
+        ret->underrunConcealment = j.value("underrunConcealment", true);
+
+        if (j.contains("asioSampleType")) {
+            std::string name = j.value("asioSampleType", "");
+            bool found = false;
+            for (const auto &p: asioSampleFormatNames) {
+                if (name == p.first) {
+                    ret->asioSampleFormat = p.second;
+                    found = true;
+                }
+            }
+            if (!found) {
+                mainlog->warn("Unknown asioSampleType \"{}\", using int32", name);
+            }
+        }
+
+        if (j.contains("dither")) {
+            std::string name = j.value("dither", "");
+            bool found = false;
+            for (const auto &p: ditherModeNames) {
+                if (name == p.first) {
+                    ret->dither = p.second;
+                    found = true;
+                }
+            }
+            if (!found) {
+                mainlog->warn("Unknown dither \"{}\", using tpdf", name);
+            }
+        }
 
         // Note:: Declare default log level on logger.cpp
         auto logLevel = j.value("logLevel", "");
@@ -85,6 +138,54 @@ UserPrefPtr loadUserPref(LPCTSTR loadRelPath) {
             }
         }
 
+        if (j.contains("overflowPolicy")) {
+            auto &overflowPolicy = j["overflowPolicy"];
+            if (!overflowPolicy.is_object()) {
+                throw AppException("overflowPolicy must be an object");
+            }
+
+            for (auto it = overflowPolicy.begin(); it != overflowPolicy.end(); ++it) {
+                std::wstring deviceId = utf8_to_wstring(it.key());
+                std::string name = it.value();
+                bool found = false;
+                for (const auto &p: overflowPolicyNames) {
+                    if (name == p.first) {
+                        ret->overflowPolicy.insert(std::make_pair(deviceId, p.second));
+                        found = true;
+                    }
+                }
+                if (!found) {
+                    mainlog->warn("Unknown overflowPolicy \"{}\", ignoring", name);
+                }
+            }
+        }
+
+        if (j.contains("outputGain")) {
+            auto &outputGain = j["outputGain"];
+            if (!outputGain.is_object()) {
+                throw AppException("outputGain must be an object");
+            }
+
+            for (auto it = outputGain.begin(); it != outputGain.end(); ++it) {
+                std::wstring deviceId = utf8_to_wstring(it.key());
+                double gain = it.value();
+                ret->outputGain.insert(std::make_pair(deviceId, gain));
+            }
+        }
+
+        if (j.contains("outputMute")) {
+            auto &outputMute = j["outputMute"];
+            if (!outputMute.is_object()) {
+                throw AppException("outputMute must be an object");
+            }
+
+            for (auto it = outputMute.begin(); it != outputMute.end(); ++it) {
+                std::wstring deviceId = utf8_to_wstring(it.key());
+                bool mute = it.value();
+                ret->outputMute.insert(std::make_pair(deviceId, mute));
+            }
+        }
+
         return ret;
     } catch (json::exception &e) {
         mainlog->error("JSON parse failed: {}", e.what());
@@ -104,7 +205,19 @@ void saveUserPref(UserPrefPtr pref, LPCTSTR saveRelPath) {
     json j;
     j["channelCount"] = pref->channelCount;
     j["clapGain"] = pref->clapGain;
+    if (pref->clapLatency >= 0) j["clapLatency"] = pref->clapLatency;
+    if (!pref->clapPack.empty()) j["clapPack"] = wstring_to_utf8(pref->clapPack);
     j["throttle"] = pref->throttle;
+    j["floatMixBus"] = pref->floatMixBus;
+    j["limiter"] = pref->limiter;
+    j["limiterLookahead"] = pref->limiterLookahead;
+    j["underrunConcealment"] = pref->underrunConcealment;
+    for (const auto &name: asioSampleFormatNames) {
+        if (pref->asioSampleFormat == name.second) j["asioSampleType"] = name.first;
+    }
+    for (const auto &name: ditherModeNames) {
+        if (pref->dither == name.second) j["dither"] = name.first;
+    }
 
     switch (pref->logLevel) {
         case spdlog::level::trace:
@@ -141,6 +254,32 @@ void saveUserPref(UserPrefPtr pref, LPCTSTR saveRelPath) {
         j["durationOverride"] = jDurationOverride;
     }
 
+    {
+        json jOverflowPolicy = json::object();
+        for (const auto &p: pref->overflowPolicy) {
+            for (const auto &name: overflowPolicyNames) {
+                if (p.second == name.second) jOverflowPolicy[wstring_to_utf8(p.first)] = name.first;
+            }
+        }
+        j["overflowPolicy"] = jOverflowPolicy;
+    }
+
+    {
+        json jOutputGain = json::object();
+        for (const auto &p: pref->outputGain) {
+            jOutputGain[wstring_to_utf8(p.first)] = p.second;
+        }
+        j["outputGain"] = jOutputGain;
+    }
+
+    {
+        json jOutputMute = json::object();
+        for (const auto &p: pref->outputMute) {
+            jOutputMute[wstring_to_utf8(p.first)] = p.second;
+        }
+        j["outputMute"] = jOutputMute;
+    }
+
     fputs(j.dump(2).c_str(), fp);
     fclose(fp);
     return;
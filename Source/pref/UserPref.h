@@ -26,14 +26,26 @@
 #include <memory>
 #include <Windows.h>
 #include <spdlog/spdlog.h>
+#include "../utils/AudioEnums.h"
 
 struct UserPref {
     int channelCount = 2;
     double clapGain = 0;
+    double clapLatency = -1;  // ms from key press to clap onset, negative for one ASIO buffer
+    std::wstring clapPack;  // folder with keydown.wav / keyup.wav, empty for the built-in sounds
     bool throttle = true;
+    bool floatMixBus = false;
+    bool limiter = false;
+    double limiterLookahead = 1.0;  // ms
+    AsioSampleFormat asioSampleFormat = AsioSampleFormat::Int32LSB;
+    DitherMode dither = DitherMode::Tpdf;  // 16-bit outputs only
+    bool underrunConcealment = true;
     spdlog::level::level_enum logLevel = spdlog::level::info;
     std::vector<std::wstring> deviceIdList;
     std::map<std::wstring, int> durationOverride;
+    std::map<std::wstring, RingOverflowPolicy> overflowPolicy;
+    std::map<std::wstring, double> outputGain;  // dB
+    std::map<std::wstring, bool> outputMute;
 };
 
 using UserPrefPtr = std::shared_ptr<UserPref>;
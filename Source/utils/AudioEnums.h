@@ -0,0 +1,53 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#ifndef TRGKASIO_AUDIOENUMS_H
+#define TRGKASIO_AUDIOENUMS_H
+
+// Option enums shared between UserPref and the audio code, kept apart so the
+// pref header doesn't have to pull in the ring buffer and conversion headers.
+
+/// What the writer does when a block doesn't fit in a reader's queue.
+enum class RingOverflowPolicy {
+    /// Drop the incoming block. The reader keeps its queued frames.
+    DropNewest,
+    /// Drop just enough of the reader's oldest frames to fit the block.
+    DropOldest,
+    /// Drop the reader's oldest frames until only `trimTarget` frames remain queued before the block.
+    Trim,
+};
+
+/// Sample types the driver can expose to the ASIO host.
+enum class AsioSampleFormat {
+    Int32LSB,
+    Float32LSB,
+    Int24LSB,  // packed, 3 bytes per sample
+    Int16LSB,
+};
+
+/// Dither applied when a device takes 16-bit samples. Other formats ignore it.
+enum class DitherMode {
+    None,    // truncate to the upper 16 bits
+    Tpdf,
+    Shaped,  // TPDF with first-order noise shaping
+};
+
+#endif //TRGKASIO_AUDIOENUMS_H
@@ -0,0 +1,350 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#ifndef TRGKASIO_BROADCASTRINGBUFFER_H
+#define TRGKASIO_BROADCASTRINGBUFFER_H
+
+#include <memory>
+#include "RingBuffer.h"
+#include "AudioEnums.h"
+
+struct RingReaderConfig {
+    /// Frames the reader can queue. Like RingBuffer's capacity, at most `limit - 1` are used.
+    size_t limit;
+    RingOverflowPolicy policy = RingOverflowPolicy::DropNewest;
+    size_t trimTarget = 0;
+    /**
+     * DropNewest only. After this many blocks in a row rejected because of
+     * this reader, it is detached: the writer drops its oldest frames like
+     * DropOldest until the reader consumes frames again. 0 never detaches.
+     */
+    size_t detachAfter = 0;
+};
+
+/**
+ * Wait-free single-producer/multi-consumer broadcast ring buffer.
+ *
+ * Every frame is written once and read by each reader, which keep independent
+ * read positions. Each reader index may only be used from one thread, and the
+ * writer from one other thread.
+ *
+ * Capacity is rounded up to a power of two, positions run freely, and all
+ * indices sit on their own cache line, as in PowerOfTwoRingBuffer.
+ *
+ * Each reader has its own queue limit and overflow policy (RingReaderConfig).
+ * A block that overflows a DropNewest reader is rejected for everyone. Other
+ * readers get their read position pushed forward by the writer instead, so a
+ * stalled reader of that kind never holds the others back. A DropNewest
+ * reader that keeps rejecting blocks can be detached (`detachAfter`), so it
+ * doesn't either.
+ *
+ * Readers publish the position they are reading from in `readSpans` and
+ * retract it in `commitRead`, so the writer never overwrites frames that are
+ * still being read even after it pushed the reader forward.
+ */
+template<typename T>
+class BroadcastRingBuffer {
+public:
+    /// `readerCount` DropNewest readers, each limited by the whole capacity.
+    BroadcastRingBuffer(size_t capacity, size_t frameSize, size_t readerCount,
+                        RingBufferStorage storage = RingBufferStorage::Heap)
+            : BroadcastRingBuffer(frameSize, std::vector<RingReaderConfig>(
+            readerCount, RingReaderConfig{roundUpPowerOfTwo(capacity)}), storage) {}
+
+    /// One reader per entry of `readers`. Capacity is the largest reader limit.
+    BroadcastRingBuffer(size_t frameSize, const std::vector<RingReaderConfig> &readers,
+                        RingBufferStorage storage = RingBufferStorage::Heap)
+            : _capacity(roundUpPowerOfTwo(maxLimit(readers))),
+              _storage(_capacity, frameSize, storage),
+              _storageMask(_storage.frames() - 1),
+              _readerCount(readers.size()),
+              _readers(std::make_unique<Reader[]>(readers.size())) {
+        for (size_t i = 0; i < _readerCount; i++) {
+            _readers[i].config = readers[i];
+        }
+    }
+
+    ~BroadcastRingBuffer() = default;
+
+    [[nodiscard]] size_t capacity() const { return _capacity; }
+
+    [[nodiscard]] size_t frameSize() const { return _storage.frameSize(); }
+
+    [[nodiscard]] size_t readerCount() const { return _readerCount; }
+
+    [[nodiscard]] bool isMirrored() const { return _storage.isMirrored(); }
+
+    [[nodiscard]] const RingReaderConfig &readerConfig(size_t reader) const { return _readers[reader].config; }
+
+    /// Frames queued for `reader`.
+    [[nodiscard]] size_t size(size_t reader) const {
+        auto rp = _readers[reader].pos.load(std::memory_order_acquire);
+        auto wp = _writePos.load(std::memory_order_acquire);
+        return wp - rp;
+    }
+
+    /// Frames queued for the slowest reader.
+    [[nodiscard]] size_t maxSize() const {
+        auto wp = _writePos.load(std::memory_order_relaxed);
+        size_t maxUsed = 0;
+        for (size_t i = 0; i < _readerCount; i++) {
+            auto used = wp - _readers[i].pos.load(std::memory_order_acquire);
+            if (used > maxUsed) maxUsed = used;
+        }
+        return maxUsed;
+    }
+
+    /**
+     * Total frames `reader` skipped because the writer dropped them under
+     * DropOldest/Trim. Counted when the reader next calls `readSpans`, so
+     * frames it was still reading when pushed forward are not counted.
+     */
+    [[nodiscard]] size_t droppedFrames(size_t reader) const {
+        return _readers[reader].droppedFrames.load(std::memory_order_relaxed);
+    }
+
+    /// True while a stalled DropNewest `reader` is detached. See RingReaderConfig::detachAfter.
+    [[nodiscard]] bool isDetached(size_t reader) const {
+        return _readers[reader].detached.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Producer side. Makes room for `frames` frames according to every
+     * reader's overflow policy. Returns spans of exactly `frames` frames,
+     * or empty spans if the block has to be dropped. Fill them and call `commitWrite`.
+     */
+    RingSpans<T> writeSpans(size_t frames) {
+        auto wp = _writePos.load(std::memory_order_relaxed);
+        auto end = wp + frames;
+
+        // Every rejection is decided before any reader is pushed forward,
+        // so nobody drops their oldest frames for a block that is rejected anyway.
+        // All DropNewest readers are checked, so each counts its own overflows.
+        bool rejected = false;
+        for (size_t i = 0; i < _readerCount; i++) {
+            auto &r = _readers[i];
+            // Decided once per block: the reader may reattach meanwhile.
+            r.writePolicy = policyOf(r);
+            if (r.writePolicy == RingOverflowPolicy::DropNewest) {
+                if (end - r.pos.load(std::memory_order_acquire) <= r.config.limit - 1) {
+                    r.overflowRun = 0;
+                    continue;
+                }
+                if (!r.config.detachAfter || ++r.overflowRun < r.config.detachAfter) {
+                    rejected = true;
+                    continue;
+                }
+                // Stalled: from now on it drops its oldest frames instead.
+                r.detached.store(true, std::memory_order_release);
+                r.writePolicy = RingOverflowPolicy::DropOldest;
+            }
+            if (frames > r.config.limit - 1) rejected = true;
+            // A reader that started reading before being pushed forward
+            // still pins its old position.
+            if (isPinnedBy(r, end)) rejected = true;
+        }
+        if (rejected) return {};
+
+        for (size_t i = 0; i < _readerCount; i++) {
+            auto &r = _readers[i];
+            if (r.writePolicy == RingOverflowPolicy::DropNewest) continue;
+
+            auto rp = r.pos.load(std::memory_order_seq_cst);
+            if (end - rp > r.config.limit - 1) {
+                size_t keep = r.config.limit - 1 - frames;
+                if (r.writePolicy == RingOverflowPolicy::Trim) keep = std::min(keep, r.config.trimTarget);
+                auto newRp = wp - keep;
+                while (isBefore(rp, newRp) &&
+                       !r.pos.compare_exchange_weak(rp, newRp, std::memory_order_seq_cst)) {}
+            }
+
+            // The reader may have claimed its old position while we pushed it.
+            // Either it sees the new position and retries, or we see its claim here.
+            if (isPinnedBy(r, end)) return {};
+        }
+
+        return _storage.template spans<T>(wp & _storageMask, frames);
+    }
+
+    /// Producer side. Publishes `frames` frames written through `writeSpans` to every reader.
+    void commitWrite(size_t frames) {
+        auto wp = _writePos.load(std::memory_order_relaxed);
+        _writePos.store(wp + frames, std::memory_order_release);
+    }
+
+    /// Producer side. Pushes `inputSize` interleaved frames, or nothing.
+    bool push(const T *input, size_t inputSize) {
+        auto spans = writeSpans(inputSize);
+        if (spans.size() < inputSize) return false;  // Write overflow
+        copyToSpans(spans, input, inputSize, frameSize());
+        commitWrite(inputSize);
+        return true;
+    }
+
+    /**
+     * Producer side. Interleaves planar input while pushing it.
+     * @param input `sample = input[channel][frameIndex]`, with one channel per frame element.
+     */
+    bool pushPlanar(const std::vector<std::vector<T>> &input) {
+        assert(input.size() == frameSize());
+        auto inputSize = input[0].size();
+
+        auto spans = writeSpans(inputSize);
+        if (spans.size() < inputSize) return false;  // Write overflow
+        copyPlanarToSpans(spans, input);
+        commitWrite(inputSize);
+        return true;
+    }
+
+    /**
+     * Consumer side. Returns the region readable by `reader`. Consume it and
+     * call `commitRead`, with 0 if nothing was consumed.
+     */
+    RingSpans<const T> readSpans(size_t reader) {
+        auto &r = _readers[reader];
+        size_t rp;
+        do {
+            rp = r.pos.load(std::memory_order_seq_cst);
+            r.claim.store(rp, std::memory_order_seq_cst);
+        } while (r.pos.load(std::memory_order_seq_cst) != rp);
+        if (isBefore(r.readEnd, rp)) {
+            r.droppedFrames.fetch_add(rp - r.readEnd, std::memory_order_relaxed);
+        }
+
+        auto wp = _writePos.load(std::memory_order_acquire);
+        return _storage.template spans<const T>(rp & _storageMask, wp - rp);
+    }
+
+    /// Consumer side. Releases `frames` frames read by `reader` through `readSpans`.
+    void commitRead(size_t reader, size_t frames) {
+        auto &r = _readers[reader];
+        auto newRp = r.claim.load(std::memory_order_relaxed) + frames;
+        r.readEnd = newRp;
+        // The writer may have pushed us further forward meanwhile.
+        auto rp = r.pos.load(std::memory_order_relaxed);
+        while (isBefore(rp, newRp) &&
+               !r.pos.compare_exchange_weak(rp, newRp, std::memory_order_seq_cst)) {}
+        r.claim.store(kNoClaim, std::memory_order_release);
+        // A detached reader that is making progress again gets its queue back.
+        if (frames && r.detached.load(std::memory_order_relaxed)) {
+            r.detached.store(false, std::memory_order_release);
+        }
+    }
+
+    /// Consumer side. Gets `requestedSize` interleaved frames for `reader`, or nothing.
+    bool get(size_t reader, T *output, size_t requestedSize) {
+        auto spans = readSpans(reader);
+        if (spans.size() < requestedSize) {
+            commitRead(reader, 0);
+            return false; // Insufficient data
+        }
+        copyFromSpans(spans, output, requestedSize, frameSize());
+        commitRead(reader, requestedSize);
+        return true;
+    }
+
+
+public:;
+
+    size_t rp(size_t reader) const { return _readers[reader].pos.load(std::memory_order_relaxed) & _storageMask; }
+
+    size_t wp() const { return _writePos.load(std::memory_order_relaxed) & _storageMask; }
+
+private:
+    static constexpr size_t kNoClaim = ~(size_t) 0;
+
+    struct alignas(64) Reader {
+        std::atomic<size_t> pos{0};
+        std::atomic<size_t> claim{kNoClaim};
+        std::atomic<size_t> droppedFrames{0};
+        std::atomic<bool> detached{false};
+        /// Where the reader's last read ended. Only used by the reader's thread.
+        size_t readEnd = 0;
+        /// Blocks in a row this DropNewest reader overflowed. Only used by the writer's thread.
+        size_t overflowRun = 0;
+        RingOverflowPolicy writePolicy = RingOverflowPolicy::DropNewest;
+        RingReaderConfig config{0};
+    };
+
+    static size_t maxLimit(const std::vector<RingReaderConfig> &readers) {
+        size_t ret = 1;
+        for (const auto &r: readers) ret = std::max(ret, r.limit);
+        return ret;
+    }
+
+    static RingOverflowPolicy policyOf(const Reader &r) {
+        if (r.detached.load(std::memory_order_acquire)) return RingOverflowPolicy::DropOldest;
+        return r.config.policy;
+    }
+
+    /// True if writing up to `end` would overwrite frames `r` is still reading.
+    bool isPinnedBy(const Reader &r, size_t end) const {
+        auto claim = r.claim.load(std::memory_order_seq_cst);
+        return claim != kNoClaim && end - claim > _capacity - 1;
+    }
+
+    // Positions run freely and may wrap around on 32-bit builds.
+    static bool isBefore(size_t a, size_t b) {
+        return (std::make_signed_t<size_t>) (a - b) < 0;
+    }
+
+    size_t _capacity;
+    RingStorage<T> _storage;
+    size_t _storageMask;
+    size_t _readerCount;
+
+    std::unique_ptr<Reader[]> _readers;
+    alignas(64) std::atomic<size_t> _writePos{0};
+};
+
+/**
+ * One reader's view of a BroadcastRingBuffer, with the same consumer
+ * interface as RingBuffer.
+ */
+template<typename T>
+class BroadcastRingReader {
+public:
+    BroadcastRingReader(std::shared_ptr<BroadcastRingBuffer<T>> ring, size_t reader)
+            : _ring(std::move(ring)), _reader(reader) {}
+
+    [[nodiscard]] size_t capacity() const { return _ring->capacity(); }
+
+    [[nodiscard]] size_t frameSize() const { return _ring->frameSize(); }
+
+    [[nodiscard]] size_t size() const { return _ring->size(_reader); }
+
+    RingSpans<const T> readSpans() { return _ring->readSpans(_reader); }
+
+    void commitRead(size_t frames) { _ring->commitRead(_reader, frames); }
+
+    bool get(T *output, size_t requestedSize) { return _ring->get(_reader, output, requestedSize); }
+
+    size_t rp() const { return _ring->rp(_reader); }
+
+    size_t wp() const { return _ring->wp(); }
+
+    size_t droppedFrames() const { return _ring->droppedFrames(_reader); }
+
+private:
+    std::shared_ptr<BroadcastRingBuffer<T>> _ring;
+    size_t _reader;
+};
+
+#endif //TRGKASIO_BROADCASTRINGBUFFER_H
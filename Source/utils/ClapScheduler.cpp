@@ -0,0 +1,47 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "ClapScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+ClapScheduler::ClapScheduler(int sampleRate, double latency)
+        : _sampleRate(sampleRate), _latency(std::max(0.0, latency)) {}
+
+int64_t ClapScheduler::beginBlock(double time, size_t frames) {
+    _blockStart = _nextBlockStart;
+    _nextBlockStart += (int64_t) frames;
+
+    double expected = _anchorTime + (double) (_blockStart - _anchorSample) / _sampleRate;
+    double error = time - expected;
+    if (!_anchored || std::fabs(error) > kResyncTime) {
+        if (_anchored) _resyncCount++;
+        _anchored = true;
+        _anchorTime = time;
+        _anchorSample = _blockStart;
+    } else {
+        _anchorTime += error * kDriftCorrection;
+    }
+    return _blockStart;
+}
+
+int64_t ClapScheduler::onsetSample(double time) const {
+    int64_t onset = _anchorSample + std::llround((time + _latency - _anchorTime) * _sampleRate);
+    return std::max(onset, _blockStart);
+}
@@ -0,0 +1,74 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#ifndef TRGKASIO_CLAPSCHEDULER_H
+#define TRGKASIO_CLAPSCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Places claps on the output sample timeline.
+ *
+ * beginBlock() is called with the accurateTime() of every rendered block.
+ * The first block anchors a line from time to output samples, and later
+ * blocks only nudge it, so scheduling jitter of the render loop doesn't
+ * move claps around. A key event at time t starts its clap at the sample
+ * of t + latency, independent of when the loop got to it. If the block
+ * times drift more than kResyncTime from the line (a stall, or a device
+ * restart), it is anchored again.
+ *
+ * Claps that would start before the current block start at its first
+ * sample, so the latency should be at least one block.
+ */
+class ClapScheduler {
+public:
+    /// Share of the timing error of each block that moves the line.
+    static constexpr double kDriftCorrection = 1.0 / 64;
+    static constexpr double kResyncTime = 0.05;  // seconds
+
+    ClapScheduler(int sampleRate, double latency);
+
+    /// Starts the next block of `frames` frames, rendered at `time`. Returns its first sample.
+    int64_t beginBlock(double time, size_t frames);
+
+    /// Sample where the clap of a key event at `time` starts. Never before the current block.
+    [[nodiscard]] int64_t onsetSample(double time) const;
+
+    [[nodiscard]] int64_t blockStart() const { return _blockStart; }
+
+    [[nodiscard]] double latency() const { return _latency; }
+
+    /// Times the line was anchored again after the first block.
+    [[nodiscard]] uint64_t resyncCount() const { return _resyncCount; }
+
+private:
+    int _sampleRate;
+    double _latency;
+    bool _anchored = false;
+    double _anchorTime = 0;
+    int64_t _anchorSample = 0;
+    int64_t _blockStart = 0;
+    int64_t _nextBlockStart = 0;
+    uint64_t _resyncCount = 0;
+};
+
+#endif //TRGKASIO_CLAPSCHEDULER_H
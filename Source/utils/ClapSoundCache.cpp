@@ -0,0 +1,109 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "ClapSoundCache.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+namespace {
+    // Entry layout: this header, then `sampleCount` doubles. Native byte order.
+    struct CacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t sampleRate;
+        uint64_t contentHash;
+        uint64_t sampleCount;
+    };
+
+    const char kMagic[8] = {'T', 'R', 'G', 'K', 'C', 'L', 'A', 'P'};
+}
+
+uint64_t clapContentHash(const uint8_t *content, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= content[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+std::filesystem::path ClapSoundCache::pathFor(uint64_t contentHash, int sampleRate) const {
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx-%d.clap", (unsigned long long) contentHash, sampleRate);
+    return _directory / name;
+}
+
+bool ClapSoundCache::read(uint64_t contentHash, int sampleRate, WaveSound *sound) const {
+    auto file = MappedFile::open(pathFor(contentHash, sampleRate));
+    if (!file || file->size() < sizeof(CacheHeader)) return false;
+
+    CacheHeader header{};
+    memcpy(&header, file->data(), sizeof(header));
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.sampleRate != (uint32_t) sampleRate || header.contentHash != contentHash) {
+        return false;
+    }
+    if (header.sampleCount != (file->size() - sizeof(header)) / sizeof(double) ||
+        (file->size() - sizeof(header)) % sizeof(double) != 0) {
+        return false;
+    }
+
+    sound->sampleRate = sampleRate;
+    sound->audio.resize(header.sampleCount);
+    memcpy(sound->audio.data(), file->data() + sizeof(header), header.sampleCount * sizeof(double));
+    return true;
+}
+
+bool ClapSoundCache::write(uint64_t contentHash, int sampleRate, const WaveSound &sound) const {
+    std::error_code ec;
+    std::filesystem::create_directories(_directory, ec);
+    if (ec) return false;
+
+    CacheHeader header{};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.sampleRate = (uint32_t) sampleRate;
+    header.contentHash = contentHash;
+    header.sampleCount = sound.audio.size();
+
+    auto path = pathFor(contentHash, sampleRate);
+    auto tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(sound.audio.data()),
+                  (std::streamsize) (sound.audio.size() * sizeof(double)));
+        out.close();
+        if (!out) {
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
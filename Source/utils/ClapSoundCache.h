@@ -0,0 +1,61 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#ifndef TRGKASIO_CLAPSOUNDCACHE_H
+#define TRGKASIO_CLAPSOUNDCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include "WaveLoad.h"
+
+/// 64-bit FNV-1a hash of a sound file's bytes.
+uint64_t clapContentHash(const uint8_t *content, size_t size);
+
+/**
+ * Resampled clap sounds kept on disk, so a later start skips decoding and
+ * resampling. Each entry is one file in `directory`, named after the hash
+ * of the source file and the target sample rate, holding the samples as
+ * they were resampled. Entries are read through a memory map and written
+ * to a temporary file that is then renamed over the old one, so a reader
+ * never sees a partial entry.
+ */
+class ClapSoundCache {
+public:
+    static constexpr uint32_t kVersion = 1;
+
+    explicit ClapSoundCache(std::filesystem::path directory) : _directory(std::move(directory)) {}
+
+    /// Reads the entry for the key into `sound`. Returns false if there is none or it is damaged.
+    bool read(uint64_t contentHash, int sampleRate, WaveSound *sound) const;
+
+    /// Stores `sound` under the key. Returns false if the entry couldn't be written.
+    bool write(uint64_t contentHash, int sampleRate, const WaveSound &sound) const;
+
+    [[nodiscard]] std::filesystem::path pathFor(uint64_t contentHash, int sampleRate) const;
+
+    [[nodiscard]] const std::filesystem::path &directory() const { return _directory; }
+
+private:
+    std::filesystem::path _directory;
+};
+
+#endif //TRGKASIO_CLAPSOUNDCACHE_H
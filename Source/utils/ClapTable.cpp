@@ -0,0 +1,65 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "ClapTable.h"
+#include "SampleConvert.h"
+#include <algorithm>
+#include <cmath>
+
+template<>
+void ClapTable<int32_t>::bake(const std::vector<float> &sound, double gain) {
+    if (_baked && _gain == gain && _samples.size() == sound.size()) return;
+    _samples.resize(sound.size());
+    for (size_t i = 0; i < sound.size(); i++) {
+        _samples[i] = (int32_t) round((double) sound[i] * gain * (1 << 24));
+    }
+    _gain = gain;
+    _baked = true;
+}
+
+template<>
+void ClapTable<float>::bake(const std::vector<float> &sound, double gain) {
+    if (_baked && _gain == gain && _samples.size() == sound.size()) return;
+    // The integer bus is 24-bit and adds samples * 2^24, so claps are twice full scale here too.
+    auto scale = (float) (gain * 2);
+    _samples.resize(sound.size());
+    for (size_t i = 0; i < sound.size(); i++) {
+        _samples[i] = sound[i] * scale;
+    }
+    _gain = gain;
+    _baked = true;
+}
+
+static void mixAdd(const int32_t *input, int32_t *output, size_t samples) { mixAddInt32(input, output, samples); }
+
+static void mixAdd(const float *input, float *output, size_t samples) { mixAddFloat(input, output, samples); }
+
+template<typename T>
+bool ClapTable<T>::mix(int64_t startSample, T *output, size_t frames) const {
+    auto length = (int64_t) _samples.size();
+    int64_t begin = std::max<int64_t>(0, -startSample);
+    int64_t end = std::min<int64_t>((int64_t) frames, length - startSample);
+    if (begin < end) {
+        mixAdd(_samples.data() + startSample + begin, output + begin, (size_t) (end - begin));
+    }
+    return startSample + (int64_t) frames < length;
+}
+
+template class ClapTable<int32_t>;
+template class ClapTable<float>;
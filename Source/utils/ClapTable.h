@@ -0,0 +1,59 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#ifndef TRGKASIO_CLAPTABLE_H
+#define TRGKASIO_CLAPTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Clap sound baked at mix bus level for one gain, so mixing it is a plain add.
+ *
+ * The int32_t table holds `round(sound * gain * 2^24)`, the level of the
+ * 24-bit bus. The float table holds `sound * gain * 2`, the same level on
+ * the float bus where 1.0 is full scale.
+ */
+template<typename T>
+class ClapTable {
+public:
+    /// Bakes `sound` at `gain`. Does nothing if it already is, and reuses the memory otherwise.
+    void bake(const std::vector<float> &sound, double gain);
+
+    /**
+     * Adds the sound, starting at its sample `startSample`, to a block of
+     * `frames` samples. A negative `startSample` starts it within the block.
+     * Returns false once the sound ends within the block.
+     */
+    bool mix(int64_t startSample, T *output, size_t frames) const;
+
+    [[nodiscard]] size_t size() const { return _samples.size(); }
+
+    [[nodiscard]] const T *data() const { return _samples.data(); }
+
+private:
+    std::vector<T> _samples;
+    double _gain = 0;
+    bool _baked = false;
+};
+
+#endif //TRGKASIO_CLAPTABLE_H
@@ -0,0 +1,85 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#ifndef TRGKASIO_CLAPVOICEPOOL_H
+#define TRGKASIO_CLAPVOICEPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct ClapVoice {
+    int sound = 0;  // index into the clap sound list
+    int64_t startSample = 0;  // output sample where the clap starts
+};
+
+/**
+ * Preallocated set of clap voices that are sounding.
+ *
+ * trigger() starts a voice, and render() visits only the active ones, so a
+ * block costs nothing when no clap plays. A voice retires when the visitor
+ * says it reached the end of its sound. When every voice is busy, a new
+ * trigger replaces the one that started first. Not thread safe.
+ */
+class ClapVoicePool {
+public:
+    explicit ClapVoicePool(size_t capacity) : _voices(capacity) {}
+
+    [[nodiscard]] size_t capacity() const { return _voices.size(); }
+
+    [[nodiscard]] size_t size() const { return _count; }
+
+    void trigger(int sound, int64_t startSample) {
+        if (_voices.empty()) return;
+        size_t slot = _count;
+        if (_count < _voices.size()) {
+            _count++;
+        } else {
+            slot = 0;
+            for (size_t i = 1; i < _count; i++) {
+                if (_voices[i].startSample < _voices[slot].startSample) slot = i;
+            }
+        }
+        _voices[slot].sound = sound;
+        _voices[slot].startSample = startSample;
+    }
+
+    /// Calls `play(voice)` on every active voice. Voices for which it returns false retire.
+    template<typename Play>
+    void render(Play play) {
+        for (size_t i = 0; i < _count;) {
+            const ClapVoice &voice = _voices[i];
+            if (play(voice)) {
+                i++;
+            } else {
+                _voices[i] = _voices[--_count];
+            }
+        }
+    }
+
+    void clear() { _count = 0; }
+
+private:
+    std::vector<ClapVoice> _voices;
+    size_t _count = 0;
+};
+
+#endif //TRGKASIO_CLAPVOICEPOOL_H
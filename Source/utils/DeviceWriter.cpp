@@ -0,0 +1,138 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "DeviceWriter.h"
+#include "SampleConvert.h"
+#include <algorithm>
+
+DeviceWriter::DeviceWriter(DeviceSampleFormat format, size_t channelCount, DitherMode dither,
+                           uint32_t ditherSeed)
+        : _dither(channelCount, ditherSeed),
+          _format(format),
+          _ditherMode(dither),
+          _channelCount(channelCount),
+          _frameBytes(channelCount * deviceSampleSize(format)) {
+}
+
+void DeviceWriter::writePlain(const RingSpans<const int32_t> &spans, size_t frames, uint8_t *out) {
+    size_t firstFrames = std::min(frames, spans.firstSize);
+    convert(spans.first, out, firstFrames);
+    if (frames > firstFrames) convert(spans.second, out + firstFrames * _frameBytes, frames - firstFrames);
+}
+
+void DeviceWriter::convert(const int32_t *in, uint8_t *out, size_t frames) {
+    size_t samples = frames * _channelCount;
+    switch (_format) {
+        case DeviceSampleFormat::Int16: {
+            auto *out16 = reinterpret_cast<int16_t *>(out);
+            if (_ditherMode == DitherMode::Tpdf) {
+                convertInt32ToInt16Dither(in, out16, samples, &_dither);
+            } else if (_ditherMode == DitherMode::Shaped) {
+                convertInt32ToInt16ShapedDither(in, out16, samples, &_dither);
+            } else {
+                convertInt32ToInt16(in, out16, samples);
+            }
+            break;
+        }
+        case DeviceSampleFormat::Int24In32:
+            convertInt32ToInt24In32(in, reinterpret_cast<int32_t *>(out), samples);
+            break;
+        case DeviceSampleFormat::Int32:
+            memcpy(out, in, samples * sizeof(int32_t));
+            break;
+        case DeviceSampleFormat::Float32:
+            convertInt32ToFloat(in, reinterpret_cast<float *>(out), samples);
+            break;
+    }
+}
+
+void DeviceWriter::writeGain(const RingSpans<const int32_t> &spans, size_t frames, uint8_t *out, float gain) {
+    if (gain != _gainTarget) {
+        _gainTarget = gain;
+        _gainStep = (gain - _gain) / (float) _gainRampFrames;
+        _gainRampLeft = _gainRampFrames;
+    }
+    if (_gainRampLeft == 0 && _gain == 0) {
+        silence(frames, out);
+        return;
+    }
+
+    // One conversion per piece of a span with a constant gain or a single ramp.
+    size_t done = 0;
+    while (done < frames) {
+        if (_gainRampLeft == 0 && _gain == 1) {
+            // Back at unity: the rest is bit-exact with the plain conversion.
+            RingSpans<const int32_t> rest;
+            if (done < spans.firstSize) {
+                rest = {spans.first + done * _channelCount, spans.firstSize - done, spans.second, spans.secondSize};
+            } else {
+                rest = {spans.second + (done - spans.firstSize) * _channelCount, spans.size() - done, nullptr, 0};
+            }
+            writePlain(rest, frames - done, out + done * _frameBytes);
+            return;
+        }
+
+        const int32_t *in;
+        size_t n;
+        if (done < spans.firstSize) {
+            in = spans.first + done * _channelCount;
+            n = std::min(frames, spans.firstSize) - done;
+        } else {
+            in = spans.second + (done - spans.firstSize) * _channelCount;
+            n = frames - done;
+        }
+        float step = 0;
+        if (_gainRampLeft) {
+            n = std::min(n, _gainRampLeft);
+            step = _gainStep;
+        }
+        convertGain(in, out + done * _frameBytes, n, _gain, step);
+        done += n;
+        if (_gainRampLeft) {
+            _gainRampLeft -= n;
+            // Land exactly on the target, so unity gain gets the plain conversion again.
+            _gain = _gainRampLeft ? _gain + step * (float) n : _gainTarget;
+        }
+    }
+}
+
+void DeviceWriter::convertGain(const int32_t *in, uint8_t *out, size_t frames, float gain, float step) {
+    size_t samples = frames * _channelCount;
+    switch (_format) {
+        case DeviceSampleFormat::Int16: {
+            auto *out16 = reinterpret_cast<int16_t *>(out);
+            if (_ditherMode == DitherMode::Tpdf) {
+                convertInt32ToInt16DitherGain(in, out16, samples, _channelCount, gain, step, &_dither);
+            } else if (_ditherMode == DitherMode::Shaped) {
+                convertInt32ToInt16ShapedDitherGain(in, out16, samples, gain, step, &_dither);
+            } else {
+                convertInt32ToInt16Gain(in, out16, samples, _channelCount, gain, step);
+            }
+            break;
+        }
+        case DeviceSampleFormat::Int24In32:
+            convertInt32ToInt24In32Gain(in, reinterpret_cast<int32_t *>(out), samples, _channelCount, gain, step);
+            break;
+        case DeviceSampleFormat::Int32:
+            convertInt32ToInt32Gain(in, reinterpret_cast<int32_t *>(out), samples, _channelCount, gain, step);
+            break;
+        case DeviceSampleFormat::Float32:
+            convertInt32ToFloatGain(in, reinterpret_cast<float *>(out), samples, _channelCount, gain, step);
+            break;
+    }
+}
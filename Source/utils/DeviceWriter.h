@@ -0,0 +1,109 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#ifndef TRGKASIO_DEVICEWRITER_H
+#define TRGKASIO_DEVICEWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "RingBuffer.h"
+#include "SampleConvert.h"
+#include "AudioEnums.h"
+
+/// Sample formats a WASAPI device buffer can take.
+enum class DeviceSampleFormat {
+    Int16,
+    Int24In32,  // 24 valid bits in a 32-bit container
+    Int32,
+    Float32,
+};
+
+constexpr size_t deviceSampleSize(DeviceSampleFormat format) {
+    return format == DeviceSampleFormat::Int16 ? 2 : 4;
+}
+
+/**
+ * Copies interleaved int32 frames from the output ring into a device buffer.
+ *
+ * Each span goes through the SIMD output kernel of the device's sample
+ * format in one call. The ring is already interleaved, so the channel count
+ * only sizes the copy. A writer also keeps the gain ramp of its output, and 16-bit writers the
+ * dither state, so each writer must only be used by one output.
+ */
+class DeviceWriter {
+public:
+    DeviceWriter() = default;
+
+    DeviceWriter(DeviceSampleFormat format, size_t channelCount, DitherMode dither = DitherMode::None,
+                 uint32_t ditherSeed = 1);
+
+    /**
+     * Writes the first `frames` frames of `spans` to `out`, scaled by `gain`.
+     * When `gain` differs from the last call, the gain ramps to it linearly
+     * over gainRampFrames(), frame by frame, inside the conversion. At unity
+     * gain the plain conversion runs.
+     */
+    void write(const RingSpans<const int32_t> &spans, size_t frames, void *out, float gain = 1) {
+        if (gain == 1 && _gain == 1 && _gainRampLeft == 0) {
+            writePlain(spans, frames, static_cast<uint8_t *>(out));
+        } else {
+            writeGain(spans, frames, static_cast<uint8_t *>(out), gain);
+        }
+    }
+
+    /// Fills `frames` frames of `out` with silence.
+    void silence(size_t frames, void *out) const {
+        memset(out, 0, frames * _frameBytes);
+    }
+
+    [[nodiscard]] size_t frameBytes() const { return _frameBytes; }
+
+    [[nodiscard]] size_t gainRampFrames() const { return _gainRampFrames; }
+
+    /// At least 1 frame.
+    void setGainRampFrames(size_t frames) { _gainRampFrames = frames ? frames : 1; }
+
+private:
+    void writePlain(const RingSpans<const int32_t> &spans, size_t frames, uint8_t *out);
+
+    /// Converts `frames` contiguous frames at unity gain.
+    void convert(const int32_t *in, uint8_t *out, size_t frames);
+
+    void writeGain(const RingSpans<const int32_t> &spans, size_t frames, uint8_t *out, float gain);
+
+    /// Converts `frames` contiguous frames with a gain ramp.
+    void convertGain(const int32_t *in, uint8_t *out, size_t frames, float gain, float step);
+
+private:
+    DitherState _dither;
+    DeviceSampleFormat _format = DeviceSampleFormat::Int32;
+    DitherMode _ditherMode = DitherMode::None;
+    size_t _channelCount = 0;
+    size_t _frameBytes = 0;
+
+    float _gain = 1;  // gain of the next frame
+    float _gainTarget = 1;
+    float _gainStep = 0;
+    size_t _gainRampLeft = 0;
+    size_t _gainRampFrames = 480;
+};
+
+#endif //TRGKASIO_DEVICEWRITER_H
@@ -0,0 +1,32 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#pragma once
+
+#ifndef TRGKASIO_KEYEVENT_H
+#define TRGKASIO_KEYEVENT_H
+
+/// Key transition seen by KeyDownListener.
+struct KeyEvent {
+    double time = 0;  // accurateTime() when the transition was seen
+    bool keyUp = false;
+};
+
+#endif //TRGKASIO_KEYEVENT_H
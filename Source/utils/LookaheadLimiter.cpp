@@ -0,0 +1,129 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "LookaheadLimiter.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+// interpolatedPeak needs 4 frames after a frame, so detection runs this far behind the input.
+static constexpr size_t kDetectorLag = 4;
+// ... and 4 frames before it.
+static constexpr size_t kDetectorHistory = kDetectorLag + 4;
+
+static size_t windowFrames(int sampleRate, double lookaheadMs) {
+    lookaheadMs = std::clamp(lookaheadMs, LookaheadLimiter::kMinLookaheadMs, LookaheadLimiter::kMaxLookaheadMs);
+    return std::max<size_t>(1, (size_t) std::lround(lookaheadMs * sampleRate / 1000.0));
+}
+
+size_t LookaheadLimiter::latencyFrames(int sampleRate, double lookaheadMs) {
+    // The gain for a frame is known once the whole window after it has been detected.
+    return windowFrames(sampleRate, lookaheadMs) - 1 + kDetectorLag;
+}
+
+LookaheadLimiter::LookaheadLimiter(size_t channelCount, int sampleRate, double lookaheadMs, size_t maxBlockFrames)
+        : _window(windowFrames(sampleRate, lookaheadMs)),
+          _delay(latencyFrames(sampleRate, lookaheadMs)),
+          _history(std::max(_delay, kDetectorHistory)),
+          _releaseCoef((float) (1 - std::exp(-1000.0 / (kReleaseMs * sampleRate)))),
+          _work(channelCount, std::vector<float>(_history + maxBlockFrames)),
+          _peak(maxBlockFrames),
+          _gain(maxBlockFrames),
+          _minValue(_window + 1),
+          _minFrame(_window + 1),
+          _box(_window, 1.0f),
+          _boxSum((double) _window) {
+}
+
+void LookaheadLimiter::pushRequiredGain(float required) {
+    // Sliding minimum over the last _window frames
+    size_t capacity = _minValue.size();
+    while (_minCount > 0) {
+        size_t back = (_minHead + _minCount - 1) % capacity;
+        if (_minValue[back] < required) break;
+        _minCount--;
+    }
+    size_t slot = (_minHead + _minCount) % capacity;
+    _minValue[slot] = required;
+    _minFrame[slot] = _frame;
+    _minCount++;
+    if (_minFrame[_minHead] + _window <= _frame) {
+        _minHead = (_minHead + 1) % capacity;
+        _minCount--;
+    }
+    float windowMin = _minValue[_minHead];
+
+    // Moving average over the same window. Re-summed once per window so rounding can't build up.
+    _boxSum += (double) windowMin - _box[_boxPos];
+    _box[_boxPos] = windowMin;
+    if (++_boxPos == _window) {
+        _boxPos = 0;
+        _boxSum = 0;
+        for (auto v: _box) _boxSum += v;
+    }
+    auto target = (float) (_boxSum / (double) _window);
+
+    // Attack is already smooth; release slowly. Both stay at or below target.
+    if (target < _lastGain) {
+        _lastGain = target;
+    } else {
+        float released = _lastGain + (target - _lastGain) * _releaseCoef;
+        // Snap once the step is too small to change the float, or the gain would never reach 1.
+        _lastGain = released == _lastGain ? target : released;
+    }
+    _frame++;
+}
+
+void LookaheadLimiter::process(std::vector<std::vector<float>> *buffer) {
+    assert(buffer && buffer->size() == _work.size());
+    if (_work.empty()) return;
+    size_t frames = (*buffer)[0].size();
+    if (_peak.size() < frames) {
+        _peak.resize(frames);
+        _gain.resize(frames);
+    }
+
+    for (size_t ch = 0; ch < _work.size(); ch++) {
+        auto &work = _work[ch];
+        if (work.size() < _history + frames) work.resize(_history + frames);
+        std::copy((*buffer)[ch].begin(), (*buffer)[ch].end(), work.begin() + (ptrdiff_t) _history);
+    }
+
+    // Peaks of the frames kDetectorLag behind the newest, across all channels
+    std::fill(_peak.begin(), _peak.begin() + (ptrdiff_t) frames, 0.0f);
+    for (auto &work: _work) {
+        interpolatedPeak(work.data() + _history - kDetectorLag, _peak.data(), frames);
+    }
+
+    for (size_t i = 0; i < frames; i++) {
+        float peak = _peak[i];
+        pushRequiredGain(peak > kCeiling ? kCeiling / peak : 1.0f);
+        _gain[i] = _lastGain;
+    }
+
+    for (size_t ch = 0; ch < _work.size(); ch++) {
+        const float *delayed = _work[ch].data() + _history - _delay;
+        float *out = (*buffer)[ch].data();
+        for (size_t i = 0; i < frames; i++) out[i] = delayed[i] * _gain[i];
+
+        // Keep the newest _history frames for the next block.
+        auto &work = _work[ch];
+        memmove(work.data(), work.data() + frames, _history * sizeof(float));
+    }
+}
@@ -0,0 +1,90 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#ifndef TRGKASIO_LOOKAHEADLIMITER_H
+#define TRGKASIO_LOOKAHEADLIMITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SampleConvert.h"
+
+/**
+ * Lookahead true-peak limiter for the float mix bus.
+ *
+ * The audio is delayed by the lookahead, so the gain can ramp down before a
+ * peak arrives instead of bending the waveform like a static curve. Peaks
+ * are detected on the 4x oversampled signal (interpolatedPeak), and the gain
+ * is shared by all channels. The gain is the sliding minimum of the gain
+ * each frame needs, smoothed by a moving average over the same window, so it
+ * reaches the needed gain exactly when the peak plays. It recovers with a
+ * one-pole release. Every step is O(1) per frame.
+ */
+class LookaheadLimiter {
+public:
+    /// Output ceiling, the soft clipper threshold. The clipper after the limiter only catches what it missed.
+    static constexpr float kCeiling = kSoftClipThreshold / (float) (1 << 23);
+    static constexpr double kMinLookaheadMs = 0.5;
+    static constexpr double kMaxLookaheadMs = 2.0;
+    static constexpr double kReleaseMs = 50;
+
+    /// Frames of delay the limiter adds. `lookaheadMs` is clamped to [kMinLookaheadMs, kMaxLookaheadMs].
+    static size_t latencyFrames(int sampleRate, double lookaheadMs);
+
+    LookaheadLimiter(size_t channelCount, int sampleRate, double lookaheadMs, size_t maxBlockFrames);
+
+    [[nodiscard]] size_t latency() const { return _delay; }
+
+    /// Limits one planar block in place. The output lags the input by latency() frames.
+    void process(std::vector<std::vector<float>> *buffer);
+
+    /// Gain applied to the last output frame.
+    [[nodiscard]] float currentGain() const { return _lastGain; }
+
+private:
+    /// Advances one frame with the gain that frame needs; updates _lastGain.
+    void pushRequiredGain(float required);
+
+private:
+    size_t _window;  // lookahead in frames
+    size_t _delay;
+    size_t _history;  // input frames kept from the previous block
+    float _releaseCoef;
+
+    std::vector<std::vector<float>> _work;  // history followed by the current block, per channel
+    std::vector<float> _peak;
+    std::vector<float> _gain;
+
+    // Monotonic queue for the sliding minimum, as a ring of _window + 1 entries.
+    std::vector<float> _minValue;
+    std::vector<uint64_t> _minFrame;
+    size_t _minHead = 0;
+    size_t _minCount = 0;
+
+    // Moving average of the sliding minimum.
+    std::vector<float> _box;
+    size_t _boxPos = 0;
+    double _boxSum = 0;
+
+    float _lastGain = 1;
+    uint64_t _frame = 0;
+};
+
+#endif //TRGKASIO_LOOKAHEADLIMITER_H
@@ -0,0 +1,90 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+
+#include <Windows.h>
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::filesystem::path &path) {
+    auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return nullptr;
+    }
+    // Zero-size files can't be mapped.
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return std::unique_ptr<MappedFile>(new MappedFile(nullptr, 0));
+    }
+
+    auto section = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);  // The section keeps the file open
+    if (!section) return nullptr;
+
+    auto view = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(section);  // The view keeps the section alive
+    if (!view) return nullptr;
+
+    return std::unique_ptr<MappedFile>(new MappedFile(static_cast<const uint8_t *>(view), (size_t) size.QuadPart));
+}
+
+MappedFile::~MappedFile() {
+    if (_data) UnmapViewOfFile(_data);
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::filesystem::path &path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+    // Zero-size files can't be mapped.
+    if (st.st_size == 0) {
+        close(fd);
+        return std::unique_ptr<MappedFile>(new MappedFile(nullptr, 0));
+    }
+
+    auto view = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping keeps the file open
+    if (view == MAP_FAILED) return nullptr;
+
+    return std::unique_ptr<MappedFile>(new MappedFile(static_cast<const uint8_t *>(view), (size_t) st.st_size));
+}
+
+MappedFile::~MappedFile() {
+    if (_data) munmap(const_cast<uint8_t *>(_data), _size);
+}
+
+#endif
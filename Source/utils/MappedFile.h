@@ -0,0 +1,56 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#ifndef TRGKASIO_MAPPEDFILE_H
+#define TRGKASIO_MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+/**
+ * Whole file mapped read-only into memory. Pages are read in on first
+ * access and shared with the OS file cache, so nothing is copied.
+ */
+class MappedFile {
+public:
+    /// Returns nullptr if the file can't be opened or mapped. Empty files map to size 0.
+    static std::unique_ptr<MappedFile> open(const std::filesystem::path &path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    [[nodiscard]] const uint8_t *data() const { return _data; }
+
+    [[nodiscard]] size_t size() const { return _size; }
+
+private:
+    MappedFile(const uint8_t *data, size_t size) : _data(data), _size(size) {}
+
+    const uint8_t *_data;
+    size_t _size;
+};
+
+#endif //TRGKASIO_MAPPEDFILE_H
@@ -0,0 +1,141 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "MirroredMemory.h"
+
+#ifdef _WIN32
+
+#include <Windows.h>
+
+#ifndef MEM_RESERVE_PLACEHOLDER
+#define MEM_RESERVE_PLACEHOLDER 0x00040000
+#endif
+#ifndef MEM_REPLACE_PLACEHOLDER
+#define MEM_REPLACE_PLACEHOLDER 0x00004000
+#endif
+#ifndef MEM_PRESERVE_PLACEHOLDER
+#define MEM_PRESERVE_PLACEHOLDER 0x00000002
+#endif
+
+// Resolved at runtime, so the driver still loads on Windows versions without them.
+using VirtualAlloc2Fn = PVOID (WINAPI *)(HANDLE, PVOID, SIZE_T, ULONG, ULONG, void *, ULONG);
+using MapViewOfFile3Fn = PVOID (WINAPI *)(HANDLE, HANDLE, PVOID, ULONG64, SIZE_T, ULONG, ULONG, void *, ULONG);
+
+size_t MirroredMemory::granularity() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwAllocationGranularity;
+}
+
+std::unique_ptr<MirroredMemory> MirroredMemory::create(size_t size) {
+    if (size == 0 || size % granularity() != 0) return nullptr;
+
+    auto hKernel = GetModuleHandle(TEXT("kernelbase.dll"));
+    if (!hKernel) return nullptr;
+    auto pVirtualAlloc2 = reinterpret_cast<VirtualAlloc2Fn>(GetProcAddress(hKernel, "VirtualAlloc2"));
+    auto pMapViewOfFile3 = reinterpret_cast<MapViewOfFile3Fn>(GetProcAddress(hKernel, "MapViewOfFile3"));
+    if (!pVirtualAlloc2 || !pMapViewOfFile3) return nullptr;
+
+    // Reserve 2 * size of address space, then split it into two placeholders.
+    auto placeholder1 = static_cast<char *>(pVirtualAlloc2(
+            nullptr, nullptr, 2 * size,
+            MEM_RESERVE | MEM_RESERVE_PLACEHOLDER, PAGE_NOACCESS,
+            nullptr, 0));
+    if (!placeholder1) return nullptr;
+
+    if (!VirtualFree(placeholder1, size, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER)) {
+        VirtualFree(placeholder1, 0, MEM_RELEASE);
+        return nullptr;
+    }
+    auto placeholder2 = placeholder1 + size;
+
+    auto section = CreateFileMapping(
+            INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+            (DWORD) ((ULONGLONG) size >> 32), (DWORD) (size & 0xffffffff),
+            nullptr);
+    if (!section) {
+        VirtualFree(placeholder1, 0, MEM_RELEASE);
+        VirtualFree(placeholder2, 0, MEM_RELEASE);
+        return nullptr;
+    }
+
+    auto view1 = pMapViewOfFile3(section, nullptr, placeholder1, 0, size,
+                                 MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, nullptr, 0);
+    auto view2 = pMapViewOfFile3(section, nullptr, placeholder2, 0, size,
+                                 MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, nullptr, 0);
+    CloseHandle(section);  // Views keep the section alive
+
+    if (!view1 || !view2) {
+        if (view1) UnmapViewOfFile(view1);
+        else VirtualFree(placeholder1, 0, MEM_RELEASE);
+        if (view2) UnmapViewOfFile(view2);
+        else VirtualFree(placeholder2, 0, MEM_RELEASE);
+        return nullptr;
+    }
+
+    return std::unique_ptr<MirroredMemory>(new MirroredMemory(view1, size));
+}
+
+MirroredMemory::~MirroredMemory() {
+    UnmapViewOfFile(_base);
+    UnmapViewOfFile(static_cast<char *>(_base) + _size);
+}
+
+#else
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+size_t MirroredMemory::granularity() {
+    return (size_t) sysconf(_SC_PAGESIZE);
+}
+
+std::unique_ptr<MirroredMemory> MirroredMemory::create(size_t size) {
+    if (size == 0 || size % granularity() != 0) return nullptr;
+
+    int fd = memfd_create("trgkasio_ring", MFD_CLOEXEC);
+    if (fd < 0) return nullptr;
+    if (ftruncate(fd, (off_t) size) != 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    // Reserve 2 * size of address space, then map the memfd over both halves.
+    auto base = static_cast<char *>(mmap(nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+    }
+
+    auto view1 = mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    auto view2 = mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    close(fd);  // Mappings keep the memfd alive
+
+    if (view1 == MAP_FAILED || view2 == MAP_FAILED) {
+        munmap(base, 2 * size);
+        return nullptr;
+    }
+
+    return std::unique_ptr<MirroredMemory>(new MirroredMemory(base, size));
+}
+
+MirroredMemory::~MirroredMemory() {
+    munmap(_base, 2 * _size);
+}
+
+#endif
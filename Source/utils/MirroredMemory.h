@@ -0,0 +1,60 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#ifndef TRGKASIO_MIRROREDMEMORY_H
+#define TRGKASIO_MIRROREDMEMORY_H
+
+#include <cstddef>
+#include <memory>
+
+/**
+ * `size` bytes of memory mapped twice, back to back. Byte `i` and byte
+ * `i + size` are the same physical memory, so a ring buffer built on top
+ * of it can read or write across its end with one linear access.
+ *
+ * Linux uses a memfd mapped twice; Windows uses VirtualAlloc2/MapViewOfFile3
+ * placeholders (Windows 10 1803+).
+ */
+class MirroredMemory {
+public:
+    /// Allocation unit. `size` passed to `create` must be a multiple of this.
+    static size_t granularity();
+
+    /// Returns nullptr if the OS cannot provide a mirrored mapping.
+    static std::unique_ptr<MirroredMemory> create(size_t size);
+
+    ~MirroredMemory();
+
+    MirroredMemory(const MirroredMemory &) = delete;
+
+    MirroredMemory &operator=(const MirroredMemory &) = delete;
+
+    [[nodiscard]] void *data() const { return _base; }
+
+    [[nodiscard]] size_t size() const { return _size; }
+
+private:
+    MirroredMemory(void *base, size_t size) : _base(base), _size(size) {}
+
+    void *_base;
+    size_t _size;
+};
+
+#endif //TRGKASIO_MIRROREDMEMORY_H
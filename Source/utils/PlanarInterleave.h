@@ -0,0 +1,38 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#pragma once
+
+#ifndef TRGKASIO_PLANARINTERLEAVE_H
+#define TRGKASIO_PLANARINTERLEAVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Interleaves planar int32 `input` into a ring region split into `first`
+ * (`firstSize` frames) and `second`, with the SIMD interleave kernels.
+ * Defined in SampleConvert.cpp.
+ */
+void interleavePlanarInt32ToSpans(const std::vector<std::vector<int32_t>> &input,
+                                  int32_t *first, size_t firstSize, int32_t *second);
+
+#endif //TRGKASIO_PLANARINTERLEAVE_H
@@ -26,92 +26,280 @@
 #define TRGKASIO_RINGBUFFER_H
 
 #include <vector>
-#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <numeric>
+#include <type_traits>
+#include "MirroredMemory.h"
+#include "PlanarInterleave.h"
 
+/**
+ * Contiguous region(s) of a ring buffer. A region that wraps around the end
+ * of the storage is split into `first` and `second`. Sizes are in frames.
+ */
 template<typename T>
+struct RingSpans {
+    T *first = nullptr;
+    size_t firstSize = 0;
+    T *second = nullptr;
+    size_t secondSize = 0;
+
+    [[nodiscard]] size_t size() const { return firstSize + secondSize; }
+};
+
+enum class RingBufferStorage {
+    Heap,
+    /// Storage mapped twice back to back (see MirroredMemory), so every span is
+    /// contiguous. Falls back to Heap when the OS cannot provide the mapping.
+    Mirrored,
+};
+
+inline size_t roundUpPowerOfTwo(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+/**
+ * Frame storage behind the ring buffer classes. Holds at least `frames`
+ * frames of `frameSize` elements; mirrored storage is rounded up to whole
+ * allocation units.
+ */
+template<typename T>
+class RingStorage {
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "RingBuffer stores raw sample data");
+
+    RingStorage(size_t frames, size_t frameSize, RingBufferStorage storage)
+            : _frames(frames), _frameSize(frameSize) {
+        if (storage == RingBufferStorage::Mirrored) {
+            // framesPerUnit is a power of two, so this keeps power-of-two sizes a power of two.
+            auto frameBytes = frameSize * sizeof(T);
+            auto granularity = MirroredMemory::granularity();
+            auto framesPerUnit = granularity / std::gcd(granularity, frameBytes);
+            auto mirroredFrames = (frames + framesPerUnit - 1) / framesPerUnit * framesPerUnit;
+            _mirrored = MirroredMemory::create(mirroredFrames * frameBytes);
+            if (_mirrored) {
+                _frames = mirroredFrames;
+                _data = static_cast<T *>(_mirrored->data());
+                return;
+            }
+        }
+        _heap.resize(frames * frameSize);
+        _data = _heap.data();
+    }
+
+    [[nodiscard]] size_t frames() const { return _frames; }
+
+    [[nodiscard]] size_t frameSize() const { return _frameSize; }
+
+    [[nodiscard]] bool isMirrored() const { return _mirrored != nullptr; }
+
+    /// `count` frames starting at frame `offset`, split at the end of storage unless mirrored.
+    template<typename U>
+    RingSpans<U> spans(size_t offset, size_t count) const {
+        RingSpans<U> spans;
+        spans.first = _data + offset * _frameSize;
+        spans.firstSize = _mirrored ? count : std::min(count, _frames - offset);
+        spans.second = _data;
+        spans.secondSize = count - spans.firstSize;
+        return spans;
+    }
+
+private:
+    T *_data;
+    std::vector<T> _heap;
+    std::unique_ptr<MirroredMemory> _mirrored;
+    size_t _frames;
+    size_t _frameSize;
+};
+
+/// Copies `frames` interleaved frames into `spans`. `spans` must have room for them.
+template<typename T>
+void copyToSpans(const RingSpans<T> &spans, const T *input, size_t frames, size_t frameSize) {
+    auto fillToEndSize = std::min(frames, spans.firstSize) * frameSize;
+    std::copy(input, input + fillToEndSize, spans.first);
+    std::copy(input + fillToEndSize, input + frames * frameSize, spans.second);
+}
+
+/**
+ * Interleaves planar `input` into `spans`. `spans` must have room for it.
+ * int32 samples go through the SIMD interleave kernels.
+ */
+template<typename T>
+void copyPlanarToSpans(const RingSpans<T> &spans, const std::vector<std::vector<T>> &input) {
+    auto frameSize = input.size();
+    auto frames = input[0].size();
+    auto fillToEndSize = std::min(frames, spans.firstSize);
+    if constexpr (std::is_same_v<T, int32_t>) {
+        interleavePlanarInt32ToSpans(input, spans.first, fillToEndSize, spans.second);
+    } else {
+        for (size_t ch = 0; ch < frameSize; ch++) {
+            const T *in = input[ch].data();
+            T *out = spans.first + ch;
+            for (size_t i = 0; i < fillToEndSize; i++, out += frameSize) *out = in[i];
+            out = spans.second + ch;
+            for (size_t i = fillToEndSize; i < frames; i++, out += frameSize) *out = in[i];
+        }
+    }
+}
+
+/// Copies `frames` interleaved frames out of `spans`. `spans` must hold them.
+template<typename T>
+void copyFromSpans(const RingSpans<const T> &spans, T *output, size_t frames, size_t frameSize) {
+    auto readToEndSize = std::min(frames, spans.firstSize) * frameSize;
+    std::copy(spans.first, spans.first + readToEndSize, output);
+    std::copy(spans.second, spans.second + frames * frameSize - readToEndSize, output + readToEndSize);
+}
+
+/**
+ * Wait-free single-producer/single-consumer ring buffer.
+ *
+ * `push` may only be called from one thread and `get` from one other thread.
+ * Each side owns one index and publishes it with release semantics, and reads
+ * the opposite index with acquire semantics, so no lock is needed.
+ *
+ * The buffer stores interleaved frames of `frameSize` elements each.
+ * Capacity, size and positions are all counted in frames, so multichannel
+ * audio shares a single pair of indices. One frame is always kept empty
+ * to tell a full buffer from an empty one, so at most `capacity - 1` frames
+ * can be stored.
+ *
+ * Besides the copying `push`/`get`, each side can access the storage in place
+ * through `writeSpans`/`commitWrite` and `readSpans`/`commitRead`.
+ *
+ * With mirrored storage the spans never wrap (`secondSize` is always 0).
+ * Storage is then rounded up to the allocation granularity, but `capacity()`
+ * still bounds the fill level to the requested value.
+ *
+ * With `PowerOfTwo` the capacity is rounded up to a power of two. Positions
+ * then run freely and are mapped to storage with a mask, so neither `size()`
+ * nor the commit calls need a division or a wrap check.
+ */
+template<typename T, bool PowerOfTwo = false>
 class RingBuffer {
 public:
-    RingBuffer(size_t capacity)
-            : _ringBuffer(capacity), _capacity(capacity), _readPos(0), _writePos(0) {}
+    explicit RingBuffer(size_t capacity, size_t frameSize = 1, RingBufferStorage storage = RingBufferStorage::Heap)
+            : _capacity(PowerOfTwo ? roundUpPowerOfTwo(capacity) : capacity),
+              _storage(_capacity, frameSize, storage),
+              _storageMask(_storage.frames() - 1) {}
 
     ~RingBuffer() = default;
 
     [[nodiscard]] size_t capacity() const { return _capacity; }
 
+    [[nodiscard]] size_t frameSize() const { return _storage.frameSize(); }
+
+    [[nodiscard]] bool isMirrored() const { return _storage.isMirrored(); }
+
     [[nodiscard]] size_t size() const {
-        return (_writePos + _capacity - _readPos) % _capacity;
+        auto rp = _readPos.load(std::memory_order_acquire);
+        auto wp = _writePos.load(std::memory_order_acquire);
+        return distance(rp, wp);
+    }
+
+    /// Producer side. Returns the free region; fill it and call `commitWrite`.
+    RingSpans<T> writeSpans() {
+        auto rp = _readPos.load(std::memory_order_acquire);
+        auto wp = _writePos.load(std::memory_order_relaxed);
+        auto available = _capacity - 1 - distance(rp, wp);
+        return _storage.template spans<T>(offset(wp), available);
+    }
+
+    /// Producer side. Publishes `frames` frames written through `writeSpans`.
+    void commitWrite(size_t frames) {
+        auto wp = _writePos.load(std::memory_order_relaxed);
+        _writePos.store(advance(wp, frames), std::memory_order_release);
+    }
+
+    /// Consumer side. Returns the readable region; consume it and call `commitRead`.
+    RingSpans<const T> readSpans() const {
+        auto wp = _writePos.load(std::memory_order_acquire);
+        auto rp = _readPos.load(std::memory_order_relaxed);
+        return _storage.template spans<const T>(offset(rp), distance(rp, wp));
     }
 
+    /// Consumer side. Releases `frames` frames read through `readSpans`.
+    void commitRead(size_t frames) {
+        auto rp = _readPos.load(std::memory_order_relaxed);
+        _readPos.store(advance(rp, frames), std::memory_order_release);
+    }
+
+    /// Producer side. Pushes `inputSize` interleaved frames, or nothing.
     bool push(const T *input, size_t inputSize) {
-        bool write_overflow = false;
-
-        auto rp = _readPos;
-        auto &wp = _writePos;
-
-        if (rp <= wp) {
-            // case 1: -----rp+++++++++++wp-------
-            if (wp + inputSize < _capacity) {
-                // case 1-1 -----rp+++++++++++wp@@@@@wp--
-                std::copy(input, input + inputSize, _ringBuffer.data() + wp);
-                wp += inputSize;
-            } else {
-                // case 1-1 @@wp--rp+++++++++++wp@@@@@@@@
-                auto fillToEndSize = _capacity - wp;
-                auto fillFromStartSize = inputSize - fillToEndSize;
-                if (fillFromStartSize >= rp) {
-                    write_overflow = true;
-                } else {
-                    std::copy(input, input + fillToEndSize, _ringBuffer.data() + wp);
-                    std::copy(input + fillToEndSize, input + inputSize, _ringBuffer.data());
-                    wp = fillFromStartSize;
-                }
-            }
-        } else {
-            // case 2: ++++wp--------------rp++++
-            if (wp + inputSize >= rp) {
-                write_overflow = true;
-            } else {
-                memcpy(
-                        _ringBuffer.data() + wp,
-                        input,
-                        inputSize * sizeof(T));
-                wp += inputSize;
-            }
-        }
+        auto spans = writeSpans();
+        if (spans.size() < inputSize) return false;  // Write overflow
+        copyToSpans(spans, input, inputSize, frameSize());
+        commitWrite(inputSize);
+        return true;
+    }
 
-        return !write_overflow;
+    /**
+     * Producer side. Interleaves planar input while pushing it.
+     * @param input `sample = input[channel][frameIndex]`, with one channel per frame element.
+     */
+    bool pushPlanar(const std::vector<std::vector<T>> &input) {
+        assert(input.size() == frameSize());
+        auto inputSize = input[0].size();
+
+        auto spans = writeSpans();
+        if (spans.size() < inputSize) return false;  // Write overflow
+        copyPlanarToSpans(spans, input);
+        commitWrite(inputSize);
+        return true;
     }
 
+    /// Consumer side. Gets `requestedSize` interleaved frames, or nothing.
     bool get(T *output, size_t requestedSize) {
-        auto size = (_writePos + _capacity - _readPos) % _capacity;
-        if (size < requestedSize) return false; // Insufficient data
-
-        auto bufferData = _ringBuffer.data();
-        const T *pIn = bufferData + _readPos;
-        const T *pInWrap = bufferData + _capacity;
-        T *pOut = output;
-        T *pOutEnd = output + requestedSize;
-
-        while (pOut < pOutEnd) {
-            *(pOut++) = *(pIn++);
-            if (pIn == pInWrap) pIn = bufferData;
-        }
-        _readPos = pIn - bufferData;
+        auto spans = readSpans();
+        if (spans.size() < requestedSize) return false; // Insufficient data
+        copyFromSpans(spans, output, requestedSize, frameSize());
+        commitRead(requestedSize);
         return true;
     }
 
 
 public:;
 
-    size_t rp() const { return _readPos; }
+    size_t rp() const { return offset(_readPos.load(std::memory_order_relaxed)); }
 
-    size_t wp() const { return _writePos; }
+    size_t wp() const { return offset(_writePos.load(std::memory_order_relaxed)); }
 
 private:
-    std::vector<T> _ringBuffer;
+    // Position -> storage offset
+    [[nodiscard]] size_t offset(size_t pos) const {
+        if constexpr (PowerOfTwo) return pos & _storageMask;
+        else return pos;
+    }
+
+    [[nodiscard]] size_t distance(size_t from, size_t to) const {
+        if constexpr (PowerOfTwo) return to - from;
+        else return (to + _storage.frames() - from) % _storage.frames();
+    }
+
+    [[nodiscard]] size_t advance(size_t pos, size_t frames) const {
+        if constexpr (PowerOfTwo) {
+            return pos + frames;
+        } else {
+            pos += frames;
+            if (pos >= _storage.frames()) pos -= _storage.frames();
+            return pos;
+        }
+    }
+
     size_t _capacity;
-    size_t _readPos = 0;
-    size_t _writePos = 0;
+    RingStorage<T> _storage;
+    size_t _storageMask;
+
+    // Consumer and producer indices live on separate cache lines, so
+    // the two threads don't false-share them.
+    alignas(64) std::atomic<size_t> _readPos{0};
+    alignas(64) std::atomic<size_t> _writePos{0};
 };
 
+template<typename T>
+using PowerOfTwoRingBuffer = RingBuffer<T, true>;
+
 #endif //TRGKASIO_RINGBUFFER_H
@@ -0,0 +1,117 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#ifndef TRGKASIO_RINGFILLSTATS_H
+#define TRGKASIO_RINGFILLSTATS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/**
+ * Lock-free fill level telemetry for a ring buffer queue.
+ *
+ * Keeps low/high watermarks and a histogram of fill levels, each bucket
+ * covering 1/kBuckets of `maxFill`. Fill levels above `maxFill` land in the
+ * last bucket. `record` may be called from any number of threads, and
+ * `snapshot`/`reset` from any other thread. A reset racing with `record`
+ * may lose that one sample, which is fine for telemetry.
+ */
+class RingFillStats {
+public:
+    static constexpr size_t kBuckets = 16;
+
+    struct Snapshot {
+        uint64_t samples = 0;
+        size_t low = 0;
+        size_t high = 0;
+        uint64_t sum = 0;
+        std::array<uint64_t, kBuckets> histogram{};
+
+        double mean() const { return samples ? (double) sum / samples : 0; }
+    };
+
+    explicit RingFillStats(size_t maxFill = 0) : _maxFill(maxFill) {
+        reset();
+    }
+
+    /// Not thread safe. Call before recording starts.
+    void setMaxFill(size_t maxFill) {
+        _maxFill = maxFill;
+        reset();
+    }
+
+    size_t maxFill() const { return _maxFill; }
+
+    /// Lower bound of `bucket`, in frames.
+    size_t bucketStart(size_t bucket) const {
+        return _maxFill * bucket / kBuckets;
+    }
+
+    void record(size_t fill) {
+        _samples.fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(fill, std::memory_order_relaxed);
+        _histogram[bucketOf(fill)].fetch_add(1, std::memory_order_relaxed);
+
+        auto low = _low.load(std::memory_order_relaxed);
+        while (fill < low && !_low.compare_exchange_weak(low, fill, std::memory_order_relaxed)) {}
+        auto high = _high.load(std::memory_order_relaxed);
+        while (fill > high && !_high.compare_exchange_weak(high, fill, std::memory_order_relaxed)) {}
+    }
+
+    Snapshot snapshot() const {
+        Snapshot s;
+        s.samples = _samples.load(std::memory_order_relaxed);
+        s.sum = _sum.load(std::memory_order_relaxed);
+        s.low = s.samples ? _low.load(std::memory_order_relaxed) : 0;
+        s.high = _high.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < kBuckets; i++) {
+            s.histogram[i] = _histogram[i].load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+    void reset() {
+        _samples.store(0, std::memory_order_relaxed);
+        _sum.store(0, std::memory_order_relaxed);
+        _low.store(std::numeric_limits<size_t>::max(), std::memory_order_relaxed);
+        _high.store(0, std::memory_order_relaxed);
+        for (auto &bucket: _histogram) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    size_t bucketOf(size_t fill) const {
+        if (fill >= _maxFill) return kBuckets - 1;
+        return fill * kBuckets / _maxFill;
+    }
+
+    size_t _maxFill;
+    std::atomic<uint64_t> _samples;
+    std::atomic<uint64_t> _sum;
+    std::atomic<size_t> _low;
+    std::atomic<size_t> _high;
+    std::array<std::atomic<uint64_t>, kBuckets> _histogram;
+};
+
+#endif //TRGKASIO_RINGFILLSTATS_H
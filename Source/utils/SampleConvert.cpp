@@ -0,0 +1,1450 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "SampleConvert.h"
+#include "SimdDispatch.h"
+#include "PlanarInterleave.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+
+using PlanarInput = std::vector<std::vector<int32_t>>;
+
+// Soft clip curve, sampled every 2^kSoftClipStepBits of overflow with
+// kSoftClipFracBits extra bits of precision. The last entry is reached at an
+// overflow of 16 * kSoftClipPadding, where the curve is within 0.2 LSB of its
+// limit, so larger overflows are clamped there.
+static constexpr int kSoftClipStepBits = 11;
+static constexpr int kSoftClipFracBits = 4;
+static constexpr int32_t kSoftClipSteps = 4096;
+static constexpr int32_t kSoftClipMaxOverflow = (kSoftClipSteps << kSoftClipStepBits) - 1;
+// Clamping the input first keeps |sample| and `|sample| - threshold` in range.
+static constexpr int32_t kSoftClipInputLimit = 1 << 30;
+
+static std::array<int32_t, kSoftClipSteps + 1> makeSoftClipTable() {
+    std::array<int32_t, kSoftClipSteps + 1> table{};
+    for (int32_t i = 0; i <= kSoftClipSteps; i++) {
+        double overflow = (double) i * (1 << kSoftClipStepBits);
+        table[i] = (int32_t) std::lround((1 << kSoftClipFracBits) * kSoftClipPadding *
+                                         std::tanh(overflow / (2.0 * kSoftClipPadding)));
+    }
+    return table;
+}
+
+static const auto softClipTable = makeSoftClipTable();
+
+// The same curve for the float mix bus, where 1.0 is 2^23 in the table above.
+static constexpr float kMixFullScale = 1 << 23;
+static constexpr float kSoftClipThresholdFloat = kSoftClipThreshold / kMixFullScale;
+static constexpr float kSoftClipStepsPerUnit = kMixFullScale / (1 << kSoftClipStepBits);
+// Just below kSoftClipSteps, so the index is at most kSoftClipSteps - 1.
+static constexpr float kSoftClipMaxPosition = kSoftClipSteps - 1.0f / 1024;
+
+static constexpr float kInt32ToFloatScale = 1.0f / 2147483648.0f;
+static constexpr float kFloatToInt32Scale = 2147483648.0f;
+// Largest float below 2^31, so output gain can saturate before converting.
+static constexpr float kInt32MaxFloat = 2147483520.0f;
+// 32-bit ASIO samples to float mix bus, with the same 15/16 gain as the integer path.
+static constexpr float kAsioToMixFloatScale = 0.9375f / 2147483648.0f;
+
+// Float ASIO input is clamped to this many times full scale on the integer mix bus.
+static constexpr float kAsioFloatLimit = 1 << 30;
+static constexpr float kAsioFloatToMix = 1 << 23;
+static constexpr float kAsioFloatToMixFloat = 0.9375f;
+
+static std::array<float, kSoftClipSteps + 1> makeSoftClipTableFloat() {
+    std::array<float, kSoftClipSteps + 1> table{};
+    double padding = kSoftClipPadding / (double) kMixFullScale;
+    for (int32_t i = 0; i <= kSoftClipSteps; i++) {
+        double overflow = i / (double) kSoftClipStepsPerUnit;
+        table[i] = (float) (padding * std::tanh(overflow / (2.0 * padding)));
+    }
+    return table;
+}
+
+static const auto softClipTableFloat = makeSoftClipTableFloat();
+
+// 4x oversampling for interpolatedPeak: one 8 tap windowed sinc per phase,
+// on input[k - 3] ... input[k + 4], for the points k + 1/4, k + 1/2, k + 3/4.
+static constexpr int kTruePeakPhases = 3;
+static constexpr int kTruePeakTaps = 8;
+using TruePeakTaps = std::array<std::array<float, kTruePeakTaps>, kTruePeakPhases>;
+
+static TruePeakTaps makeTruePeakTaps() {
+    const double pi = 3.14159265358979323846;
+    TruePeakTaps taps{};
+    for (int p = 0; p < kTruePeakPhases; p++) {
+        double h[kTruePeakTaps], sum = 0;
+        for (int t = 0; t < kTruePeakTaps; t++) {
+            double d = (t - 3) - (p + 1) / 4.0;
+            double sinc = std::sin(pi * d) / (pi * d);
+            double window = 0.5 + 0.5 * std::cos(pi * d / 4.5);  // Hann, zero at +-4.5
+            h[t] = sinc * window;
+            sum += h[t];
+        }
+        for (int t = 0; t < kTruePeakTaps; t++) taps[p][t] = (float) (h[t] / sum);
+    }
+    return taps;
+}
+
+static const auto truePeakTaps = makeTruePeakTaps();
+
+// The taps again, each repeated across a 256-bit vector for the SIMD versions.
+struct alignas(32) BroadcastTruePeakTaps {
+    float v[kTruePeakPhases][kTruePeakTaps][8];
+};
+
+static BroadcastTruePeakTaps makeBroadcastTruePeakTaps() {
+    BroadcastTruePeakTaps taps{};
+    for (int p = 0; p < kTruePeakPhases; p++) {
+        for (int t = 0; t < kTruePeakTaps; t++) {
+            for (auto &lane: taps.v[p][t]) lane = truePeakTaps[p][t];
+        }
+    }
+    return taps;
+}
+
+static const auto broadcastTruePeakTaps = makeBroadcastTruePeakTaps();
+
+/////////////////////////////////////////////////////////// Scalar
+
+static void interleaveScalar(const PlanarInput &input, size_t offset, size_t frames, int32_t *output) {
+    auto channels = input.size();
+    for (size_t ch = 0; ch < channels; ch++) {
+        const int32_t *in = input[ch].data() + offset;
+        int32_t *out = output + ch;
+        for (size_t i = 0; i < frames; i++, out += channels) *out = in[i];
+    }
+}
+
+static void toInt16Scalar(const int32_t *input, int16_t *output, size_t samples) {
+    for (size_t i = 0; i < samples; i++) output[i] = (int16_t) (input[i] >> 16);
+}
+
+static inline uint32_t xorshift32(uint32_t x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+// Rounds to 16 bits with TPDF dither from one 32-bit random number. Works in
+// units of 2^-15 LSB on input >> 1, so adding the dither can't overflow.
+static inline int16_t ditherToInt16(int32_t input, uint32_t random) {
+    int32_t u1 = (int32_t) random >> 17;  // each uniform in [-1/2, 1/2) LSB
+    int32_t u2 = (int32_t) (random << 16) >> 17;
+    int32_t q = ((input >> 1) + u1 + u2 + (1 << 14)) >> 15;
+    return (int16_t) std::min(std::max(q, -32768), 32767);
+}
+
+static void toInt16DitherScalar(const int32_t *input, int16_t *output, size_t samples, uint32_t *rng) {
+    for (size_t i = 0; i < samples; i++) {
+        auto &state = rng[i % kDitherLanes];
+        state = xorshift32(state);
+        output[i] = ditherToInt16(input[i], state);
+    }
+}
+
+static void toInt24In32Scalar(const int32_t *input, int32_t *output, size_t samples) {
+    for (size_t i = 0; i < samples; i++) output[i] = (int32_t) ((uint32_t) input[i] & 0xFFFFFF00u);
+}
+
+static inline int32_t asioSampleToMix(int32_t input) {
+    int32_t sample = input >> 8;  // Scale 32bit to 24bit (To prevent overflow in later steps)
+    return sample - (sample >> 4);  // multiply 15/16 ( = 0.9375 ) for later compression
+}
+
+// Packed little endian 24-bit sample, in the upper 24 bits of an int32.
+static inline int32_t loadInt24(const uint8_t *p) {
+    return (int32_t) ((uint32_t) p[0] << 8 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 24);
+}
+
+static void asioToMixScalar(const int32_t *input, int32_t *output, size_t samples) {
+    for (size_t i = 0; i < samples; i++) output[i] = asioSampleToMix(input[i]);
+}
+
+static void asioInt24ToMixScalar(const uint8_t *input, int32_t *output, size_t samples) {
+    for (size_t i = 0; i < samples; i++) output[i] = asioSampleToMix(loadInt24(input + i * 3));
+}
+
+static void asioInt16ToMixScalar(const int16_t *input, int32_t *output, size_t samples) {
+    for (size_t i = 0; i < samples; i++) output[i] = asioSampleToMix((int32_t) ((uint32_t) input[i] << 16));
+}
+
+// Host NaN would reach lrintf/cvtps (INT_MIN, a full-scale click), so it becomes silence.
+static void asioFloat32ToMixScalar(const float *input, int32_t *output, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        float in = std::isnan(input[i]) ? 0.0f : input[i];
+        float v = std::min(std::max(in * kAsioFloatToMix, -kAsioFloatLimit), kAsioFloatLimit);
+        int32_t sample = (int32_t) std::lrintf(v);
+        output[i] = sample - (sample >> 4);
+    }
+}
+
+static void softClipScalar(int32_t *samples, size_t count) {
+    const int32_t *table = softClipTable.data();
+    for (size_t i = 0; i < count; i++) {
+        int32_t s = std::clamp(samples[i], -kSoftClipInputLimit, kSoftClipInputLimit);
+        int32_t sign = s >> 31;
+        int32_t a = (s ^ sign) - sign;
+        int32_t overflow = std::max(a - kSoftClipThreshold, 0);
+        int32_t base = a - overflow;
+        overflow = std::min(overflow, kSoftClipMaxOverflow);
+        int32_t idx = overflow >> kSoftClipStepBits;
+        int32_t frac = overflow & ((1 << kSoftClipStepBits) - 1);
+        int32_t lo = table[idx], hi = table[idx + 1];
+        int32_t curve = lo + (((hi - lo) * frac) >> kSoftClipStepBits);
+        int32_t r = base + ((curve + (1 << (kSoftClipFracBits - 1))) >> kSoftClipFracBits);
+        samples[i] = (int32_t) ((uint32_t) ((r ^ sign) - sign) << 8);
+    }
+}
+
+static void int32ToFloatScalar(const int32_t *input, float *output, size_t samples) {
+    for (size_t i = 0; i < samples; i++) output[i] = (float) input[i] * kInt32ToFloatScale;
+}
+
+static void asioToMixFloatScalar(const int32_t *input, float *output, size_t samples) {
+    for (size_t i = 0; i < samples; i++) output[i] = (float) input[i] * kAsioToMixFloatScale;
+}
+
+static void asioInt24ToMixFloatScalar(const uint8_t *input, float *output, size_t samples) {
+    for (size_t i = 0; i < samples; i++) output[i] = (float) loadInt24(input + i * 3) * kAsioToMixFloatScale;
+}
+
+static void asioInt16ToMixFloatScalar(const int16_t *input, float *output, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        output[i] = (float) (int32_t) ((uint32_t) input[i] << 16) * kAsioToMixFloatScale;
+    }
+}
+
+static void asioFloat32ToMixFloatScalar(const float *input, float *output, size_t samples) {
+    for (size_t i = 0; i < samples; i++) output[i] = std::isnan(input[i]) ? 0.0f : input[i] * kAsioFloatToMixFloat;
+}
+
+static void softClipFloatScalar(const float *input, int32_t *output, size_t count) {
+    const float *table = softClipTableFloat.data();
+    for (size_t i = 0; i < count; i++) {
+        float a = std::fabs(input[i]);
+        // Compares ordered like minps/maxps, which return the second operand on NaN:
+        // NaN clips to the threshold at table position 0, the same as the SIMD kernels.
+        float base = a < kSoftClipThresholdFloat ? a : kSoftClipThresholdFloat;
+        float overflow = a - kSoftClipThresholdFloat > 0.0f ? a - kSoftClipThresholdFloat : 0.0f;
+        float pos = overflow * kSoftClipStepsPerUnit;
+        pos = pos < kSoftClipMaxPosition ? pos : kSoftClipMaxPosition;
+        auto idx = (int32_t) pos;
+        float frac = pos - (float) idx;
+        float lo = table[idx], hi = table[idx + 1];
+        float curve = lo + (hi - lo) * frac;
+        float r = std::copysign(base + curve, input[i]);
+        output[i] = (int32_t) std::lrintf(r * kFloatToInt32Scale);
+    }
+}
+
+// Value at x + (phase + 1) / 4. Accumulates in tap order, like the SIMD versions.
+static inline float interpolateAt(const float *x, int phase) {
+    const auto &h = truePeakTaps[phase];
+    float acc = h[0] * x[-3];
+    for (int t = 1; t < kTruePeakTaps; t++) acc += h[t] * x[t - 3];
+    return acc;
+}
+
+static void interpolatedPeakScalar(const float *input, float *peak, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float m = std::max(peak[i], std::fabs(input[i]));
+        for (int p = 0; p < kTruePeakPhases; p++) {
+            m = std::max(m, std::fabs(interpolateAt(input + i - 1, p)));
+            m = std::max(m, std::fabs(interpolateAt(input + i, p)));
+        }
+        peak[i] = m;
+    }
+}
+
+// Output gain: scales by `gain`, rounds to nearest and saturates to 32 bits.
+static inline int32_t applyGain(int32_t input, float gain) {
+    float v = std::min(std::max((float) input * gain, -kFloatToInt32Scale), kInt32MaxFloat);
+    return (int32_t) std::lrintf(v);
+}
+
+// Calls store(i, sample) with each sample scaled by the gain of its frame.
+template<typename Store>
+static inline void forEachGainSample(const int32_t *input, size_t samples, size_t channels, float gain, float step,
+                                     Store store) {
+    for (size_t i = 0, frame = 0; i < samples; frame++) {
+        float g = gain + (float) frame * step;
+        for (size_t ch = 0; ch < channels && i < samples; ch++, i++) store(i, applyGain(input[i], g));
+    }
+}
+
+static void toInt16GainScalar(const int32_t *input, int16_t *output, size_t samples, size_t channels, float gain,
+                              float step) {
+    forEachGainSample(input, samples, channels, gain, step, [&](size_t i, int32_t s) {
+        output[i] = (int16_t) (s >> 16);
+    });
+}
+
+static void toInt16DitherGainScalar(const int32_t *input, int16_t *output, size_t samples, size_t channels,
+                                    float gain, float step, uint32_t *rng) {
+    forEachGainSample(input, samples, channels, gain, step, [&](size_t i, int32_t s) {
+        auto &state = rng[i % kDitherLanes];
+        state = xorshift32(state);
+        output[i] = ditherToInt16(s, state);
+    });
+}
+
+static void toInt24In32GainScalar(const int32_t *input, int32_t *output, size_t samples, size_t channels,
+                                  float gain, float step) {
+    forEachGainSample(input, samples, channels, gain, step, [&](size_t i, int32_t s) {
+        output[i] = (int32_t) ((uint32_t) s & 0xFFFFFF00u);
+    });
+}
+
+static void toInt32GainScalar(const int32_t *input, int32_t *output, size_t samples, size_t channels, float gain,
+                              float step) {
+    forEachGainSample(input, samples, channels, gain, step, [&](size_t i, int32_t s) {
+        output[i] = s;
+    });
+}
+
+static void toFloatGainScalar(const int32_t *input, float *output, size_t samples, size_t channels, float gain,
+                              float step) {
+    forEachGainSample(input, samples, channels, gain, step, [&](size_t i, int32_t s) {
+        output[i] = (float) s * kInt32ToFloatScale;
+    });
+}
+
+// Wraps on overflow like the SIMD versions.
+static void mixAddScalar(const int32_t *input, int32_t *output, size_t samples) {
+    for (size_t i = 0; i < samples; i++) output[i] = (int32_t) ((uint32_t) output[i] + (uint32_t) input[i]);
+}
+
+static void mixAddFloatScalar(const float *input, float *output, size_t samples) {
+    for (size_t i = 0; i < samples; i++) output[i] += input[i];
+}
+
+#ifdef TRGKASIO_SIMD_X86
+
+/////////////////////////////////////////////////////////// SSE2
+
+static inline void transpose4x4(__m128i r0, __m128i r1, __m128i r2, __m128i r3,
+                                __m128i &f0, __m128i &f1, __m128i &f2, __m128i &f3) {
+    auto t0 = _mm_unpacklo_epi32(r0, r1);
+    auto t1 = _mm_unpackhi_epi32(r0, r1);
+    auto t2 = _mm_unpacklo_epi32(r2, r3);
+    auto t3 = _mm_unpackhi_epi32(r2, r3);
+    f0 = _mm_unpacklo_epi64(t0, t2);
+    f1 = _mm_unpackhi_epi64(t0, t2);
+    f2 = _mm_unpacklo_epi64(t1, t3);
+    f3 = _mm_unpackhi_epi64(t1, t3);
+}
+
+static inline __m128i load128(const int32_t *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+
+static inline void store128(int32_t *p, __m128i v) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+
+static inline void store64(int32_t *p, __m128i v) { _mm_storel_epi64(reinterpret_cast<__m128i *>(p), v); }
+
+static void interleaveSSE2(const PlanarInput &input, size_t offset, size_t frames, int32_t *output) {
+    auto channels = input.size();
+    size_t i = 0;
+    if (channels == 2) {
+        const int32_t *c0 = input[0].data() + offset, *c1 = input[1].data() + offset;
+        for (; i + 4 <= frames; i += 4) {
+            auto l = load128(c0 + i), r = load128(c1 + i);
+            store128(output + i * 2, _mm_unpacklo_epi32(l, r));
+            store128(output + i * 2 + 4, _mm_unpackhi_epi32(l, r));
+        }
+    } else if (channels == 6) {
+        const int32_t *c[6];
+        for (size_t ch = 0; ch < 6; ch++) c[ch] = input[ch].data() + offset;
+        for (; i + 4 <= frames; i += 4) {
+            __m128i f0, f1, f2, f3;
+            transpose4x4(load128(c[0] + i), load128(c[1] + i), load128(c[2] + i), load128(c[3] + i),
+                         f0, f1, f2, f3);
+            auto c4 = load128(c[4] + i), c5 = load128(c[5] + i);
+            auto p01 = _mm_unpacklo_epi32(c4, c5), p23 = _mm_unpackhi_epi32(c4, c5);
+            auto out = output + i * 6;
+            store128(out, f0);
+            store64(out + 4, p01);
+            store128(out + 6, f1);
+            store64(out + 10, _mm_unpackhi_epi64(p01, p01));
+            store128(out + 12, f2);
+            store64(out + 16, p23);
+            store128(out + 18, f3);
+            store64(out + 22, _mm_unpackhi_epi64(p23, p23));
+        }
+    } else if (channels == 8) {
+        const int32_t *c[8];
+        for (size_t ch = 0; ch < 8; ch++) c[ch] = input[ch].data() + offset;
+        for (; i + 4 <= frames; i += 4) {
+            __m128i a0, a1, a2, a3, b0, b1, b2, b3;
+            transpose4x4(load128(c[0] + i), load128(c[1] + i), load128(c[2] + i), load128(c[3] + i),
+                         a0, a1, a2, a3);
+            transpose4x4(load128(c[4] + i), load128(c[5] + i), load128(c[6] + i), load128(c[7] + i),
+                         b0, b1, b2, b3);
+            auto out = output + i * 8;
+            store128(out, a0);
+            store128(out + 4, b0);
+            store128(out + 8, a1);
+            store128(out + 12, b1);
+            store128(out + 16, a2);
+            store128(out + 20, b2);
+            store128(out + 24, a3);
+            store128(out + 28, b3);
+        }
+    }
+    interleaveScalar(input, offset + i, frames - i, output + i * channels);
+}
+
+static void toInt16SSE2(const int32_t *input, int16_t *output, size_t samples) {
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        auto a = _mm_srai_epi32(load128(input + i), 16);
+        auto b = _mm_srai_epi32(load128(input + i + 4), 16);
+        // Values already fit in 16 bits, so the saturating pack is exact.
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm_packs_epi32(a, b));
+    }
+    toInt16Scalar(input + i, output + i, samples - i);
+}
+
+static inline __m128i xorshift32SSE2(__m128i x) {
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    return _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+}
+
+static inline __m128i ditherToInt32SSE2(__m128i input, __m128i random) {
+    auto u1 = _mm_srai_epi32(random, 17);
+    auto u2 = _mm_srai_epi32(_mm_slli_epi32(random, 16), 17);
+    auto t = _mm_add_epi32(_mm_add_epi32(_mm_srai_epi32(input, 1), u1), _mm_add_epi32(u2, _mm_set1_epi32(1 << 14)));
+    return _mm_srai_epi32(t, 15);
+}
+
+static void toInt16DitherSSE2(const int32_t *input, int16_t *output, size_t samples, uint32_t *rng) {
+    auto rngLow = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rng));
+    auto rngHigh = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rng + 4));
+    size_t i = 0;
+    for (; i + kDitherLanes <= samples; i += kDitherLanes) {
+        rngLow = xorshift32SSE2(rngLow);
+        rngHigh = xorshift32SSE2(rngHigh);
+        auto a = ditherToInt32SSE2(load128(input + i), rngLow);
+        auto b = ditherToInt32SSE2(load128(input + i + 4), rngHigh);
+        // Saturating pack, same as the clamp in ditherToInt16.
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm_packs_epi32(a, b));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(rng), rngLow);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(rng + 4), rngHigh);
+    toInt16DitherScalar(input + i, output + i, samples - i, rng);
+}
+
+static void toInt24In32SSE2(const int32_t *input, int32_t *output, size_t samples) {
+    size_t i = 0;
+    auto mask = _mm_set1_epi32((int32_t) 0xFFFFFF00u);
+    for (; i + 4 <= samples; i += 4) {
+        store128(output + i, _mm_and_si128(load128(input + i), mask));
+    }
+    toInt24In32Scalar(input + i, output + i, samples - i);
+}
+
+static inline __m128i asioSampleToMixSSE2(__m128i input) {
+    auto s = _mm_srai_epi32(input, 8);
+    return _mm_sub_epi32(s, _mm_srai_epi32(s, 4));
+}
+
+static void asioToMixSSE2(const int32_t *input, int32_t *output, size_t samples) {
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        store128(output + i, asioSampleToMixSSE2(load128(input + i)));
+    }
+    asioToMixScalar(input + i, output + i, samples - i);
+}
+
+static void asioInt16ToMixSSE2(const int16_t *input, int32_t *output, size_t samples) {
+    size_t i = 0;
+    auto zero = _mm_setzero_si128();
+    for (; i + 8 <= samples; i += 8) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i));
+        store128(output + i, asioSampleToMixSSE2(_mm_unpacklo_epi16(zero, v)));
+        store128(output + i + 4, asioSampleToMixSSE2(_mm_unpackhi_epi16(zero, v)));
+    }
+    asioInt16ToMixScalar(input + i, output + i, samples - i);
+}
+
+static void asioFloat32ToMixSSE2(const float *input, int32_t *output, size_t samples) {
+    size_t i = 0;
+    auto scale = _mm_set1_ps(kAsioFloatToMix);
+    auto high = _mm_set1_ps(kAsioFloatLimit), low = _mm_set1_ps(-kAsioFloatLimit);
+    for (; i + 4 <= samples; i += 4) {
+        auto x = _mm_loadu_ps(input + i);
+        x = _mm_and_ps(x, _mm_cmpord_ps(x, x));  // NaN to 0
+        auto v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(x, scale), low), high);
+        auto s = _mm_cvtps_epi32(v);
+        store128(output + i, _mm_sub_epi32(s, _mm_srai_epi32(s, 4)));
+    }
+    asioFloat32ToMixScalar(input + i, output + i, samples - i);
+}
+
+// SSE2 has no pminsd/pmaxsd.
+static inline __m128i min128(__m128i a, __m128i b) {
+    auto m = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(m, b), _mm_andnot_si128(m, a));
+}
+
+static inline __m128i max128(__m128i a, __m128i b) {
+    auto m = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+
+static void softClipSSE2(int32_t *samples, size_t count) {
+    const int32_t *table = softClipTable.data();
+    const auto limit = _mm_set1_epi32(kSoftClipInputLimit);
+    const auto threshold = _mm_set1_epi32(kSoftClipThreshold);
+    const auto maxOverflow = _mm_set1_epi32(kSoftClipMaxOverflow);
+    const auto fracMask = _mm_set1_epi32((1 << kSoftClipStepBits) - 1);
+    const auto half = _mm_set1_epi32(1 << (kSoftClipFracBits - 1));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        auto s = min128(max128(load128(samples + i), _mm_sub_epi32(_mm_setzero_si128(), limit)), limit);
+        auto sign = _mm_srai_epi32(s, 31);
+        auto a = _mm_sub_epi32(_mm_xor_si128(s, sign), sign);
+        auto overflow = _mm_sub_epi32(a, threshold);
+        overflow = _mm_andnot_si128(_mm_srai_epi32(overflow, 31), overflow);  // max(overflow, 0)
+        auto base = _mm_sub_epi32(a, overflow);
+        overflow = min128(overflow, maxOverflow);
+
+        alignas(16) int32_t idx[4], lo[4], hi[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(idx), _mm_srli_epi32(overflow, kSoftClipStepBits));
+        for (int j = 0; j < 4; j++) {
+            lo[j] = table[idx[j]];
+            hi[j] = table[idx[j] + 1];
+        }
+        auto vlo = _mm_load_si128(reinterpret_cast<const __m128i *>(lo));
+        auto vhi = _mm_load_si128(reinterpret_cast<const __m128i *>(hi));
+        // Both factors fit in the low 16 bits of each lane, so madd is a 32-bit multiply here.
+        auto prod = _mm_madd_epi16(_mm_sub_epi32(vhi, vlo), _mm_and_si128(overflow, fracMask));
+        auto curve = _mm_add_epi32(_mm_add_epi32(vlo, _mm_srli_epi32(prod, kSoftClipStepBits)), half);
+        auto r = _mm_add_epi32(base, _mm_srli_epi32(curve, kSoftClipFracBits));
+        r = _mm_sub_epi32(_mm_xor_si128(r, sign), sign);
+        store128(samples + i, _mm_slli_epi32(r, 8));
+    }
+    softClipScalar(samples + i, count - i);
+}
+
+static void int32ToFloatSSE2(const int32_t *input, float *output, size_t samples) {
+    size_t i = 0;
+    auto scale = _mm_set1_ps(kInt32ToFloatScale);
+    for (; i + 4 <= samples; i += 4) {
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(load128(input + i)), scale));
+    }
+    int32ToFloatScalar(input + i, output + i, samples - i);
+}
+
+static void asioToMixFloatSSE2(const int32_t *input, float *output, size_t samples) {
+    size_t i = 0;
+    auto scale = _mm_set1_ps(kAsioToMixFloatScale);
+    for (; i + 4 <= samples; i += 4) {
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(load128(input + i)), scale));
+    }
+    asioToMixFloatScalar(input + i, output + i, samples - i);
+}
+
+static void asioInt16ToMixFloatSSE2(const int16_t *input, float *output, size_t samples) {
+    size_t i = 0;
+    auto scale = _mm_set1_ps(kAsioToMixFloatScale);
+    auto zero = _mm_setzero_si128();
+    for (; i + 8 <= samples; i += 8) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i));
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(zero, v)), scale));
+        _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(zero, v)), scale));
+    }
+    asioInt16ToMixFloatScalar(input + i, output + i, samples - i);
+}
+
+static void asioFloat32ToMixFloatSSE2(const float *input, float *output, size_t samples) {
+    size_t i = 0;
+    auto scale = _mm_set1_ps(kAsioFloatToMixFloat);
+    for (; i + 4 <= samples; i += 4) {
+        auto x = _mm_loadu_ps(input + i);
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_and_ps(x, _mm_cmpord_ps(x, x)), scale));
+    }
+    asioFloat32ToMixFloatScalar(input + i, output + i, samples - i);
+}
+
+static void softClipFloatSSE2(const float *input, int32_t *output, size_t count) {
+    const float *table = softClipTableFloat.data();
+    const auto signMask = _mm_set1_ps(-0.0f);
+    const auto threshold = _mm_set1_ps(kSoftClipThresholdFloat);
+    const auto stepsPerUnit = _mm_set1_ps(kSoftClipStepsPerUnit);
+    const auto maxPosition = _mm_set1_ps(kSoftClipMaxPosition);
+    const auto toInt32 = _mm_set1_ps(kFloatToInt32Scale);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        auto x = _mm_loadu_ps(input + i);
+        auto a = _mm_andnot_ps(signMask, x);
+        auto base = _mm_min_ps(a, threshold);
+        auto overflow = _mm_max_ps(_mm_sub_ps(a, threshold), _mm_setzero_ps());
+        auto pos = _mm_min_ps(_mm_mul_ps(overflow, stepsPerUnit), maxPosition);
+        auto idx = _mm_cvttps_epi32(pos);
+        auto frac = _mm_sub_ps(pos, _mm_cvtepi32_ps(idx));
+
+        alignas(16) int32_t idxs[4];
+        alignas(16) float lo[4], hi[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(idxs), idx);
+        for (int j = 0; j < 4; j++) {
+            lo[j] = table[idxs[j]];
+            hi[j] = table[idxs[j] + 1];
+        }
+        auto vlo = _mm_load_ps(lo), vhi = _mm_load_ps(hi);
+        auto curve = _mm_add_ps(vlo, _mm_mul_ps(_mm_sub_ps(vhi, vlo), frac));
+        auto r = _mm_or_ps(_mm_add_ps(base, curve), _mm_and_ps(x, signMask));
+        store128(output + i, _mm_cvtps_epi32(_mm_mul_ps(r, toInt32)));
+    }
+    softClipFloatScalar(input + i, output + i, count - i);
+}
+
+static void interpolatedPeakSSE2(const float *input, float *peak, size_t count) {
+    const auto signMask = _mm_set1_ps(-0.0f);
+    const auto &taps = broadcastTruePeakTaps.v;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // Shared by both sides: tap t reads xs[t] for the points before i, xs[t + 1] for those after.
+        __m128 xs[kTruePeakTaps + 1];
+        for (int j = 0; j <= kTruePeakTaps; j++) xs[j] = _mm_loadu_ps(input + i - 4 + j);
+
+        auto m = _mm_max_ps(_mm_loadu_ps(peak + i), _mm_andnot_ps(signMask, xs[4]));
+        for (int p = 0; p < kTruePeakPhases; p++) {
+            auto h = _mm_load_ps(taps[p][0]);
+            auto before = _mm_mul_ps(h, xs[0]);
+            auto after = _mm_mul_ps(h, xs[1]);
+            for (int t = 1; t < kTruePeakTaps; t++) {
+                h = _mm_load_ps(taps[p][t]);
+                before = _mm_add_ps(before, _mm_mul_ps(h, xs[t]));
+                after = _mm_add_ps(after, _mm_mul_ps(h, xs[t + 1]));
+            }
+            m = _mm_max_ps(m, _mm_andnot_ps(signMask, before));
+            m = _mm_max_ps(m, _mm_andnot_ps(signMask, after));
+        }
+        _mm_storeu_ps(peak + i, m);
+    }
+    interpolatedPeakScalar(input + i, peak + i, count - i);
+}
+
+static inline __m128i applyGainSSE2(__m128i input, __m128 gain) {
+    auto v = _mm_mul_ps(_mm_cvtepi32_ps(input), gain);
+    v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-kFloatToInt32Scale)), _mm_set1_ps(kInt32MaxFloat));
+    return _mm_cvtps_epi32(v);
+}
+
+// The gain kernels only vectorize constant gain. Ramps last a few ms after
+// a change, so they run the scalar version.
+
+static void toInt16GainSSE2(const int32_t *input, int16_t *output, size_t samples, size_t channels, float gain,
+                            float step) {
+    if (step != 0) return toInt16GainScalar(input, output, samples, channels, gain, step);
+    auto g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        auto a = _mm_srai_epi32(applyGainSSE2(load128(input + i), g), 16);
+        auto b = _mm_srai_epi32(applyGainSSE2(load128(input + i + 4), g), 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm_packs_epi32(a, b));
+    }
+    toInt16GainScalar(input + i, output + i, samples - i, channels, gain, 0);
+}
+
+static void toInt16DitherGainSSE2(const int32_t *input, int16_t *output, size_t samples, size_t channels,
+                                  float gain, float step, uint32_t *rng) {
+    if (step != 0) return toInt16DitherGainScalar(input, output, samples, channels, gain, step, rng);
+    auto g = _mm_set1_ps(gain);
+    auto rngLow = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rng));
+    auto rngHigh = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rng + 4));
+    size_t i = 0;
+    for (; i + kDitherLanes <= samples; i += kDitherLanes) {
+        rngLow = xorshift32SSE2(rngLow);
+        rngHigh = xorshift32SSE2(rngHigh);
+        auto a = ditherToInt32SSE2(applyGainSSE2(load128(input + i), g), rngLow);
+        auto b = ditherToInt32SSE2(applyGainSSE2(load128(input + i + 4), g), rngHigh);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm_packs_epi32(a, b));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(rng), rngLow);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(rng + 4), rngHigh);
+    toInt16DitherGainScalar(input + i, output + i, samples - i, channels, gain, 0, rng);
+}
+
+static void toInt24In32GainSSE2(const int32_t *input, int32_t *output, size_t samples, size_t channels,
+                                float gain, float step) {
+    if (step != 0) return toInt24In32GainScalar(input, output, samples, channels, gain, step);
+    auto g = _mm_set1_ps(gain);
+    auto mask = _mm_set1_epi32((int32_t) 0xFFFFFF00u);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        store128(output + i, _mm_and_si128(applyGainSSE2(load128(input + i), g), mask));
+    }
+    toInt24In32GainScalar(input + i, output + i, samples - i, channels, gain, 0);
+}
+
+static void toInt32GainSSE2(const int32_t *input, int32_t *output, size_t samples, size_t channels, float gain,
+                            float step) {
+    if (step != 0) return toInt32GainScalar(input, output, samples, channels, gain, step);
+    auto g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        store128(output + i, applyGainSSE2(load128(input + i), g));
+    }
+    toInt32GainScalar(input + i, output + i, samples - i, channels, gain, 0);
+}
+
+static void toFloatGainSSE2(const int32_t *input, float *output, size_t samples, size_t channels, float gain,
+                            float step) {
+    if (step != 0) return toFloatGainScalar(input, output, samples, channels, gain, step);
+    auto g = _mm_set1_ps(gain);
+    auto scale = _mm_set1_ps(kInt32ToFloatScale);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(applyGainSSE2(load128(input + i), g)), scale));
+    }
+    toFloatGainScalar(input + i, output + i, samples - i, channels, gain, 0);
+}
+
+static void mixAddSSE2(const int32_t *input, int32_t *output, size_t samples) {
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        store128(output + i, _mm_add_epi32(load128(output + i), load128(input + i)));
+    }
+    mixAddScalar(input + i, output + i, samples - i);
+}
+
+static void mixAddFloatSSE2(const float *input, float *output, size_t samples) {
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        _mm_storeu_ps(output + i, _mm_add_ps(_mm_loadu_ps(output + i), _mm_loadu_ps(input + i)));
+    }
+    mixAddFloatScalar(input + i, output + i, samples - i);
+}
+
+/////////////////////////////////////////////////////////// AVX2
+
+TRGKASIO_TARGET_AVX2
+static inline __m256i load256(const int32_t *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+
+TRGKASIO_TARGET_AVX2
+static inline void store256(int32_t *p, __m256i v) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+
+TRGKASIO_TARGET_AVX2
+static void interleaveAVX2(const PlanarInput &input, size_t offset, size_t frames, int32_t *output) {
+    auto channels = input.size();
+    size_t i = 0;
+    if (channels == 2) {
+        const int32_t *c0 = input[0].data() + offset, *c1 = input[1].data() + offset;
+        for (; i + 8 <= frames; i += 8) {
+            auto l = load256(c0 + i), r = load256(c1 + i);
+            auto lo = _mm256_unpacklo_epi32(l, r);  // frames 0 1 | 4 5
+            auto hi = _mm256_unpackhi_epi32(l, r);  // frames 2 3 | 6 7
+            store256(output + i * 2, _mm256_permute2x128_si256(lo, hi, 0x20));
+            store256(output + i * 2 + 8, _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+    } else if (channels == 8) {
+        const int32_t *c[8];
+        for (size_t ch = 0; ch < 8; ch++) c[ch] = input[ch].data() + offset;
+        for (; i + 8 <= frames; i += 8) {
+            auto r0 = load256(c[0] + i), r1 = load256(c[1] + i), r2 = load256(c[2] + i), r3 = load256(c[3] + i);
+            auto r4 = load256(c[4] + i), r5 = load256(c[5] + i), r6 = load256(c[6] + i), r7 = load256(c[7] + i);
+            auto t0 = _mm256_unpacklo_epi32(r0, r1), t1 = _mm256_unpackhi_epi32(r0, r1);
+            auto t2 = _mm256_unpacklo_epi32(r2, r3), t3 = _mm256_unpackhi_epi32(r2, r3);
+            auto t4 = _mm256_unpacklo_epi32(r4, r5), t5 = _mm256_unpackhi_epi32(r4, r5);
+            auto t6 = _mm256_unpacklo_epi32(r6, r7), t7 = _mm256_unpackhi_epi32(r6, r7);
+            // uN: channels 0-3 (or 4-7) of frame N | frame N + 4
+            auto u0 = _mm256_unpacklo_epi64(t0, t2), u1 = _mm256_unpackhi_epi64(t0, t2);
+            auto u2 = _mm256_unpacklo_epi64(t1, t3), u3 = _mm256_unpackhi_epi64(t1, t3);
+            auto u4 = _mm256_unpacklo_epi64(t4, t6), u5 = _mm256_unpackhi_epi64(t4, t6);
+            auto u6 = _mm256_unpacklo_epi64(t5, t7), u7 = _mm256_unpackhi_epi64(t5, t7);
+            auto out = output + i * 8;
+            store256(out, _mm256_permute2x128_si256(u0, u4, 0x20));
+            store256(out + 8, _mm256_permute2x128_si256(u1, u5, 0x20));
+            store256(out + 16, _mm256_permute2x128_si256(u2, u6, 0x20));
+            store256(out + 24, _mm256_permute2x128_si256(u3, u7, 0x20));
+            store256(out + 32, _mm256_permute2x128_si256(u0, u4, 0x31));
+            store256(out + 40, _mm256_permute2x128_si256(u1, u5, 0x31));
+            store256(out + 48, _mm256_permute2x128_si256(u2, u6, 0x31));
+            store256(out + 56, _mm256_permute2x128_si256(u3, u7, 0x31));
+        }
+    }
+    // 6 channels don't fit 256-bit lanes well; SSE2 handles them and the tails.
+    interleaveSSE2(input, offset + i, frames - i, output + i * channels);
+}
+
+TRGKASIO_TARGET_AVX2
+static void toInt16AVX2(const int32_t *input, int16_t *output, size_t samples) {
+    size_t i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        auto a = _mm256_srai_epi32(load256(input + i), 16);
+        auto b = _mm256_srai_epi32(load256(input + i + 8), 16);
+        // packs works per 128-bit lane: a0-3 b0-3 | a4-7 b4-7
+        auto packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), packed);
+    }
+    toInt16SSE2(input + i, output + i, samples - i);
+}
+
+// Steps the eight xorshift32 lanes in `state`, and rounds `input` to 16 bits with their dither.
+TRGKASIO_TARGET_AVX2
+static inline __m256i ditherToInt32AVX2(__m256i input, __m256i *state) {
+    auto x = *state;
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+    *state = x;
+    auto u1 = _mm256_srai_epi32(x, 17);
+    auto u2 = _mm256_srai_epi32(_mm256_slli_epi32(x, 16), 17);
+    auto t = _mm256_add_epi32(_mm256_add_epi32(_mm256_srai_epi32(input, 1), u1),
+                              _mm256_add_epi32(u2, _mm256_set1_epi32(1 << 14)));
+    return _mm256_srai_epi32(t, 15);
+}
+
+TRGKASIO_TARGET_AVX2
+static void toInt16DitherAVX2(const int32_t *input, int16_t *output, size_t samples, uint32_t *rng) {
+    auto state = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rng));
+    size_t i = 0;
+    for (; i + kDitherLanes <= samples; i += kDitherLanes) {
+        auto q = ditherToInt32AVX2(load256(input + i), &state);
+        // packs works per 128-bit lane: q0-3 q0-3 | q4-7 q4-7
+        auto packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(q, q), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm256_castsi256_si128(packed));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(rng), state);
+    toInt16DitherScalar(input + i, output + i, samples - i, rng);
+}
+
+TRGKASIO_TARGET_AVX2
+static void toInt24In32AVX2(const int32_t *input, int32_t *output, size_t samples) {
+    size_t i = 0;
+    auto mask = _mm256_set1_epi32((int32_t) 0xFFFFFF00u);
+    for (; i + 8 <= samples; i += 8) {
+        store256(output + i, _mm256_and_si256(load256(input + i), mask));
+    }
+    toInt24In32SSE2(input + i, output + i, samples - i);
+}
+
+TRGKASIO_TARGET_AVX2
+static void asioToMixAVX2(const int32_t *input, int32_t *output, size_t samples) {
+    size_t i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        auto a = _mm256_srai_epi32(load256(input + i), 8);
+        auto b = _mm256_srai_epi32(load256(input + i + 8), 8);
+        store256(output + i, _mm256_sub_epi32(a, _mm256_srai_epi32(a, 4)));
+        store256(output + i + 8, _mm256_sub_epi32(b, _mm256_srai_epi32(b, 4)));
+    }
+    asioToMixSSE2(input + i, output + i, samples - i);
+}
+
+TRGKASIO_TARGET_AVX2
+static inline __m256i asioSampleToMixAVX2(__m256i input) {
+    auto s = _mm256_srai_epi32(input, 8);
+    return _mm256_sub_epi32(s, _mm256_srai_epi32(s, 4));
+}
+
+// 8 packed 24-bit samples at `p` to the upper 24 bits of 8 int32s. Reads 32 bytes.
+TRGKASIO_TARGET_AVX2
+static inline __m256i loadInt24x8(const uint8_t *p) {
+    auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    // Bytes 0-11 to the low lane, 12-23 to the high lane.
+    v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6));
+    auto shuffle = _mm256_setr_epi8(
+            -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+            -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    return _mm256_shuffle_epi8(v, shuffle);
+}
+
+TRGKASIO_TARGET_AVX2
+static void asioInt24ToMixAVX2(const uint8_t *input, int32_t *output, size_t samples) {
+    size_t i = 0;
+    // loadInt24x8 reads 8 bytes past the 8 samples.
+    for (; i + 11 <= samples; i += 8) {
+        store256(output + i, asioSampleToMixAVX2(loadInt24x8(input + i * 3)));
+    }
+    asioInt24ToMixScalar(input + i * 3, output + i, samples - i);
+}
+
+TRGKASIO_TARGET_AVX2
+static void asioInt16ToMixAVX2(const int16_t *input, int32_t *output, size_t samples) {
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        auto v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i)));
+        store256(output + i, asioSampleToMixAVX2(_mm256_slli_epi32(v, 16)));
+    }
+    asioInt16ToMixSSE2(input + i, output + i, samples - i);
+}
+
+TRGKASIO_TARGET_AVX2
+static void asioFloat32ToMixAVX2(const float *input, int32_t *output, size_t samples) {
+    size_t i = 0;
+    auto scale = _mm256_set1_ps(kAsioFloatToMix);
+    auto high = _mm256_set1_ps(kAsioFloatLimit), low = _mm256_set1_ps(-kAsioFloatLimit);
+    for (; i + 8 <= samples; i += 8) {
+        auto x = _mm256_loadu_ps(input + i);
+        x = _mm256_and_ps(x, _mm256_cmp_ps(x, x, _CMP_ORD_Q));  // NaN to 0
+        auto v = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(x, scale), low), high);
+        auto s = _mm256_cvtps_epi32(v);
+        store256(output + i, _mm256_sub_epi32(s, _mm256_srai_epi32(s, 4)));
+    }
+    asioFloat32ToMixSSE2(input + i, output + i, samples - i);
+}
+
+TRGKASIO_TARGET_AVX2
+static void softClipAVX2(int32_t *samples, size_t count) {
+    const int32_t *table = softClipTable.data();
+    const auto limit = _mm256_set1_epi32(kSoftClipInputLimit);
+    const auto negLimit = _mm256_set1_epi32(-kSoftClipInputLimit);
+    const auto threshold = _mm256_set1_epi32(kSoftClipThreshold);
+    const auto maxOverflow = _mm256_set1_epi32(kSoftClipMaxOverflow);
+    const auto fracMask = _mm256_set1_epi32((1 << kSoftClipStepBits) - 1);
+    const auto half = _mm256_set1_epi32(1 << (kSoftClipFracBits - 1));
+    const auto zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        auto s = _mm256_min_epi32(_mm256_max_epi32(load256(samples + i), negLimit), limit);
+        auto a = _mm256_abs_epi32(s);
+        auto overflow = _mm256_max_epi32(_mm256_sub_epi32(a, threshold), zero);
+        auto base = _mm256_sub_epi32(a, overflow);
+        overflow = _mm256_min_epi32(overflow, maxOverflow);
+
+        auto idx = _mm256_srli_epi32(overflow, kSoftClipStepBits);
+        auto lo = _mm256_i32gather_epi32(table, idx, 4);
+        auto hi = _mm256_i32gather_epi32(table + 1, idx, 4);
+        auto prod = _mm256_mullo_epi32(_mm256_sub_epi32(hi, lo), _mm256_and_si256(overflow, fracMask));
+        auto curve = _mm256_add_epi32(_mm256_add_epi32(lo, _mm256_srli_epi32(prod, kSoftClipStepBits)), half);
+        auto r = _mm256_add_epi32(base, _mm256_srli_epi32(curve, kSoftClipFracBits));
+        r = _mm256_sign_epi32(r, s);  // s == 0 gives 0, and r is 0 there anyway
+        store256(samples + i, _mm256_slli_epi32(r, 8));
+    }
+    softClipSSE2(samples + i, count - i);
+}
+
+TRGKASIO_TARGET_AVX2
+static void int32ToFloatAVX2(const int32_t *input, float *output, size_t samples) {
+    size_t i = 0;
+    auto scale = _mm256_set1_ps(kInt32ToFloatScale);
+    for (; i + 8 <= samples; i += 8) {
+        _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(load256(input + i)), scale));
+    }
+    int32ToFloatSSE2(input + i, output + i, samples - i);
+}
+
+TRGKASIO_TARGET_AVX2
+static void asioToMixFloatAVX2(const int32_t *input, float *output, size_t samples) {
+    size_t i = 0;
+    auto scale = _mm256_set1_ps(kAsioToMixFloatScale);
+    for (; i + 8 <= samples; i += 8) {
+        _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(load256(input + i)), scale));
+    }
+    asioToMixFloatSSE2(input + i, output + i, samples - i);
+}
+
+TRGKASIO_TARGET_AVX2
+static void asioInt24ToMixFloatAVX2(const uint8_t *input, float *output, size_t samples) {
+    size_t i = 0;
+    auto scale = _mm256_set1_ps(kAsioToMixFloatScale);
+    for (; i + 11 <= samples; i += 8) {
+        _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(loadInt24x8(input + i * 3)), scale));
+    }
+    asioInt24ToMixFloatScalar(input + i * 3, output + i, samples - i);
+}
+
+TRGKASIO_TARGET_AVX2
+static void asioInt16ToMixFloatAVX2(const int16_t *input, float *output, size_t samples) {
+    size_t i = 0;
+    auto scale = _mm256_set1_ps(kAsioToMixFloatScale);
+    for (; i + 8 <= samples; i += 8) {
+        auto v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i)));
+        _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_slli_epi32(v, 16)), scale));
+    }
+    asioInt16ToMixFloatSSE2(input + i, output + i, samples - i);
+}
+
+TRGKASIO_TARGET_AVX2
+static void asioFloat32ToMixFloatAVX2(const float *input, float *output, size_t samples) {
+    size_t i = 0;
+    auto scale = _mm256_set1_ps(kAsioFloatToMixFloat);
+    for (; i + 8 <= samples; i += 8) {
+        auto x = _mm256_loadu_ps(input + i);
+        _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_and_ps(x, _mm256_cmp_ps(x, x, _CMP_ORD_Q)), scale));
+    }
+    asioFloat32ToMixFloatSSE2(input + i, output + i, samples - i);
+}
+
+TRGKASIO_TARGET_AVX2
+static void softClipFloatAVX2(const float *input, int32_t *output, size_t count) {
+    const float *table = softClipTableFloat.data();
+    const auto signMask = _mm256_set1_ps(-0.0f);
+    const auto threshold = _mm256_set1_ps(kSoftClipThresholdFloat);
+    const auto stepsPerUnit = _mm256_set1_ps(kSoftClipStepsPerUnit);
+    const auto maxPosition = _mm256_set1_ps(kSoftClipMaxPosition);
+    const auto toInt32 = _mm256_set1_ps(kFloatToInt32Scale);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        auto x = _mm256_loadu_ps(input + i);
+        auto a = _mm256_andnot_ps(signMask, x);
+        auto base = _mm256_min_ps(a, threshold);
+        auto overflow = _mm256_max_ps(_mm256_sub_ps(a, threshold), _mm256_setzero_ps());
+        auto pos = _mm256_min_ps(_mm256_mul_ps(overflow, stepsPerUnit), maxPosition);
+        auto idx = _mm256_cvttps_epi32(pos);
+        auto frac = _mm256_sub_ps(pos, _mm256_cvtepi32_ps(idx));
+        auto lo = _mm256_i32gather_ps(table, idx, 4);
+        auto hi = _mm256_i32gather_ps(table + 1, idx, 4);
+        auto curve = _mm256_add_ps(lo, _mm256_mul_ps(_mm256_sub_ps(hi, lo), frac));
+        auto r = _mm256_or_ps(_mm256_add_ps(base, curve), _mm256_and_ps(x, signMask));
+        store256(output + i, _mm256_cvtps_epi32(_mm256_mul_ps(r, toInt32)));
+    }
+    softClipFloatSSE2(input + i, output + i, count - i);
+}
+
+TRGKASIO_TARGET_AVX2
+static void interpolatedPeakAVX2(const float *input, float *peak, size_t count) {
+    const auto signMask = _mm256_set1_ps(-0.0f);
+    const auto &taps = broadcastTruePeakTaps.v;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 xs[kTruePeakTaps + 1];
+        for (int j = 0; j <= kTruePeakTaps; j++) xs[j] = _mm256_loadu_ps(input + i - 4 + j);
+
+        auto m = _mm256_max_ps(_mm256_loadu_ps(peak + i), _mm256_andnot_ps(signMask, xs[4]));
+        for (int p = 0; p < kTruePeakPhases; p++) {
+            auto h = _mm256_load_ps(taps[p][0]);
+            auto before = _mm256_mul_ps(h, xs[0]);
+            auto after = _mm256_mul_ps(h, xs[1]);
+            for (int t = 1; t < kTruePeakTaps; t++) {
+                h = _mm256_load_ps(taps[p][t]);
+                before = _mm256_add_ps(before, _mm256_mul_ps(h, xs[t]));
+                after = _mm256_add_ps(after, _mm256_mul_ps(h, xs[t + 1]));
+            }
+            m = _mm256_max_ps(m, _mm256_andnot_ps(signMask, before));
+            m = _mm256_max_ps(m, _mm256_andnot_ps(signMask, after));
+        }
+        _mm256_storeu_ps(peak + i, m);
+    }
+    interpolatedPeakSSE2(input + i, peak + i, count - i);
+}
+
+TRGKASIO_TARGET_AVX2
+static inline __m256i applyGainAVX2(__m256i input, __m256 gain) {
+    auto v = _mm256_mul_ps(_mm256_cvtepi32_ps(input), gain);
+    v = _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(-kFloatToInt32Scale)), _mm256_set1_ps(kInt32MaxFloat));
+    return _mm256_cvtps_epi32(v);
+}
+
+TRGKASIO_TARGET_AVX2
+static void toInt16GainAVX2(const int32_t *input, int16_t *output, size_t samples, size_t channels, float gain,
+                            float step) {
+    if (step != 0) return toInt16GainScalar(input, output, samples, channels, gain, step);
+    auto g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        auto a = _mm256_srai_epi32(applyGainAVX2(load256(input + i), g), 16);
+        auto b = _mm256_srai_epi32(applyGainAVX2(load256(input + i + 8), g), 16);
+        auto packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), packed);
+    }
+    toInt16GainSSE2(input + i, output + i, samples - i, channels, gain, 0);
+}
+
+TRGKASIO_TARGET_AVX2
+static void toInt16DitherGainAVX2(const int32_t *input, int16_t *output, size_t samples, size_t channels,
+                                  float gain, float step, uint32_t *rng) {
+    if (step != 0) return toInt16DitherGainScalar(input, output, samples, channels, gain, step, rng);
+    auto g = _mm256_set1_ps(gain);
+    auto state = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rng));
+    size_t i = 0;
+    for (; i + kDitherLanes <= samples; i += kDitherLanes) {
+        auto q = ditherToInt32AVX2(applyGainAVX2(load256(input + i), g), &state);
+        auto packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(q, q), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm256_castsi256_si128(packed));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(rng), state);
+    toInt16DitherGainScalar(input + i, output + i, samples - i, channels, gain, 0, rng);
+}
+
+TRGKASIO_TARGET_AVX2
+static void toInt24In32GainAVX2(const int32_t *input, int32_t *output, size_t samples, size_t channels,
+                                float gain, float step) {
+    if (step != 0) return toInt24In32GainScalar(input, output, samples, channels, gain, step);
+    auto g = _mm256_set1_ps(gain);
+    auto mask = _mm256_set1_epi32((int32_t) 0xFFFFFF00u);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        store256(output + i, _mm256_and_si256(applyGainAVX2(load256(input + i), g), mask));
+    }
+    toInt24In32GainSSE2(input + i, output + i, samples - i, channels, gain, 0);
+}
+
+TRGKASIO_TARGET_AVX2
+static void toInt32GainAVX2(const int32_t *input, int32_t *output, size_t samples, size_t channels, float gain,
+                            float step) {
+    if (step != 0) return toInt32GainScalar(input, output, samples, channels, gain, step);
+    auto g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        store256(output + i, applyGainAVX2(load256(input + i), g));
+    }
+    toInt32GainSSE2(input + i, output + i, samples - i, channels, gain, 0);
+}
+
+TRGKASIO_TARGET_AVX2
+static void toFloatGainAVX2(const int32_t *input, float *output, size_t samples, size_t channels, float gain,
+                            float step) {
+    if (step != 0) return toFloatGainScalar(input, output, samples, channels, gain, step);
+    auto g = _mm256_set1_ps(gain);
+    auto scale = _mm256_set1_ps(kInt32ToFloatScale);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        auto v = _mm256_cvtepi32_ps(applyGainAVX2(load256(input + i), g));
+        _mm256_storeu_ps(output + i, _mm256_mul_ps(v, scale));
+    }
+    toFloatGainSSE2(input + i, output + i, samples - i, channels, gain, 0);
+}
+
+TRGKASIO_TARGET_AVX2
+static void mixAddAVX2(const int32_t *input, int32_t *output, size_t samples) {
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        store256(output + i, _mm256_add_epi32(load256(output + i), load256(input + i)));
+    }
+    mixAddSSE2(input + i, output + i, samples - i);
+}
+
+TRGKASIO_TARGET_AVX2
+static void mixAddFloatAVX2(const float *input, float *output, size_t samples) {
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        _mm256_storeu_ps(output + i, _mm256_add_ps(_mm256_loadu_ps(output + i), _mm256_loadu_ps(input + i)));
+    }
+    mixAddFloatSSE2(input + i, output + i, samples - i);
+}
+
+#endif
+
+/////////////////////////////////////////////////////////// Dispatch
+
+namespace {
+    struct Kernels {
+        SimdLevel level;
+        void (*interleave)(const PlanarInput &, size_t, size_t, int32_t *);
+        void (*toInt16)(const int32_t *, int16_t *, size_t);
+        void (*toInt16Dither)(const int32_t *, int16_t *, size_t, uint32_t *);
+        void (*toInt24In32)(const int32_t *, int32_t *, size_t);
+        void (*toFloat)(const int32_t *, float *, size_t);
+        void (*asioToMix)(const int32_t *, int32_t *, size_t);
+        void (*asioToMixFloat)(const int32_t *, float *, size_t);
+        void (*asioInt24ToMix)(const uint8_t *, int32_t *, size_t);
+        void (*asioInt24ToMixFloat)(const uint8_t *, float *, size_t);
+        void (*asioInt16ToMix)(const int16_t *, int32_t *, size_t);
+        void (*asioInt16ToMixFloat)(const int16_t *, float *, size_t);
+        void (*asioFloat32ToMix)(const float *, int32_t *, size_t);
+        void (*asioFloat32ToMixFloat)(const float *, float *, size_t);
+        void (*softClip)(int32_t *, size_t);
+        void (*softClipFloat)(const float *, int32_t *, size_t);
+        void (*interpolatedPeak)(const float *, float *, size_t);
+        void (*toInt16Gain)(const int32_t *, int16_t *, size_t, size_t, float, float);
+        void (*toInt16DitherGain)(const int32_t *, int16_t *, size_t, size_t, float, float, uint32_t *);
+        void (*toInt24In32Gain)(const int32_t *, int32_t *, size_t, size_t, float, float);
+        void (*toInt32Gain)(const int32_t *, int32_t *, size_t, size_t, float, float);
+        void (*toFloatGain)(const int32_t *, float *, size_t, size_t, float, float);
+        void (*mixAdd)(const int32_t *, int32_t *, size_t);
+        void (*mixAddFloat)(const float *, float *, size_t);
+    };
+}
+
+static Kernels kernelsFor(SimdLevel level) {
+    Kernels k{};
+#ifdef TRGKASIO_SIMD_X86
+    if (level == SimdLevel::AVX2) {
+        k.level = level;
+        k.interleave = interleaveAVX2;
+        k.toInt16 = toInt16AVX2;
+        k.toInt16Dither = toInt16DitherAVX2;
+        k.toInt24In32 = toInt24In32AVX2;
+        k.toFloat = int32ToFloatAVX2;
+        k.asioToMix = asioToMixAVX2;
+        k.asioToMixFloat = asioToMixFloatAVX2;
+        k.asioInt24ToMix = asioInt24ToMixAVX2;
+        k.asioInt24ToMixFloat = asioInt24ToMixFloatAVX2;
+        k.asioInt16ToMix = asioInt16ToMixAVX2;
+        k.asioInt16ToMixFloat = asioInt16ToMixFloatAVX2;
+        k.asioFloat32ToMix = asioFloat32ToMixAVX2;
+        k.asioFloat32ToMixFloat = asioFloat32ToMixFloatAVX2;
+        k.softClip = softClipAVX2;
+        k.softClipFloat = softClipFloatAVX2;
+        k.interpolatedPeak = interpolatedPeakAVX2;
+        k.toInt16Gain = toInt16GainAVX2;
+        k.toInt16DitherGain = toInt16DitherGainAVX2;
+        k.toInt24In32Gain = toInt24In32GainAVX2;
+        k.toInt32Gain = toInt32GainAVX2;
+        k.toFloatGain = toFloatGainAVX2;
+        k.mixAdd = mixAddAVX2;
+        k.mixAddFloat = mixAddFloatAVX2;
+        return k;
+    } else if (level == SimdLevel::SSE2) {
+        k.level = level;
+        k.interleave = interleaveSSE2;
+        k.toInt16 = toInt16SSE2;
+        k.toInt16Dither = toInt16DitherSSE2;
+        k.toInt24In32 = toInt24In32SSE2;
+        k.toFloat = int32ToFloatSSE2;
+        k.asioToMix = asioToMixSSE2;
+        k.asioToMixFloat = asioToMixFloatSSE2;
+        // Packed 24-bit needs a byte shuffle (SSSE3), so SSE2 uses the scalar version.
+        k.asioInt24ToMix = asioInt24ToMixScalar;
+        k.asioInt24ToMixFloat = asioInt24ToMixFloatScalar;
+        k.asioInt16ToMix = asioInt16ToMixSSE2;
+        k.asioInt16ToMixFloat = asioInt16ToMixFloatSSE2;
+        k.asioFloat32ToMix = asioFloat32ToMixSSE2;
+        k.asioFloat32ToMixFloat = asioFloat32ToMixFloatSSE2;
+        k.softClip = softClipSSE2;
+        k.softClipFloat = softClipFloatSSE2;
+        k.interpolatedPeak = interpolatedPeakSSE2;
+        k.toInt16Gain = toInt16GainSSE2;
+        k.toInt16DitherGain = toInt16DitherGainSSE2;
+        k.toInt24In32Gain = toInt24In32GainSSE2;
+        k.toInt32Gain = toInt32GainSSE2;
+        k.toFloatGain = toFloatGainSSE2;
+        k.mixAdd = mixAddSSE2;
+        k.mixAddFloat = mixAddFloatSSE2;
+        return k;
+    }
+#endif
+    k.level = SimdLevel::Scalar;
+    k.interleave = interleaveScalar;
+    k.toInt16 = toInt16Scalar;
+    k.toInt16Dither = toInt16DitherScalar;
+    k.toInt24In32 = toInt24In32Scalar;
+    k.toFloat = int32ToFloatScalar;
+    k.asioToMix = asioToMixScalar;
+    k.asioToMixFloat = asioToMixFloatScalar;
+    k.asioInt24ToMix = asioInt24ToMixScalar;
+    k.asioInt24ToMixFloat = asioInt24ToMixFloatScalar;
+    k.asioInt16ToMix = asioInt16ToMixScalar;
+    k.asioInt16ToMixFloat = asioInt16ToMixFloatScalar;
+    k.asioFloat32ToMix = asioFloat32ToMixScalar;
+    k.asioFloat32ToMixFloat = asioFloat32ToMixFloatScalar;
+    k.softClip = softClipScalar;
+    k.softClipFloat = softClipFloatScalar;
+    k.interpolatedPeak = interpolatedPeakScalar;
+    k.toInt16Gain = toInt16GainScalar;
+    k.toInt16DitherGain = toInt16DitherGainScalar;
+    k.toInt24In32Gain = toInt24In32GainScalar;
+    k.toInt32Gain = toInt32GainScalar;
+    k.toFloatGain = toFloatGainScalar;
+    k.mixAdd = mixAddScalar;
+    k.mixAddFloat = mixAddFloatScalar;
+    return k;
+}
+
+static Kernels &kernels() {
+    static Kernels k = kernelsFor(detectSimdLevel());
+    return k;
+}
+
+SimdLevel detectSimdLevel() {
+#ifdef TRGKASIO_SIMD_X86
+    static SimdLevel level = cpuHasAVX2() ? SimdLevel::AVX2 : SimdLevel::SSE2;
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel simdLevel() {
+    return kernels().level;
+}
+
+void setSimdLevel(SimdLevel level) {
+    if ((int) level > (int) detectSimdLevel()) level = detectSimdLevel();
+    kernels() = kernelsFor(level);
+}
+
+const char *simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2:
+            return "avx2";
+        case SimdLevel::SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+void interleaveInt32(const PlanarInput &input, size_t offset, size_t frames, int32_t *output) {
+    kernels().interleave(input, offset, frames, output);
+}
+
+void interleavePlanarInt32ToSpans(const PlanarInput &input, int32_t *first, size_t firstSize, int32_t *second) {
+    auto frames = input[0].size();
+    interleaveInt32(input, 0, firstSize, first);
+    interleaveInt32(input, firstSize, frames - firstSize, second);
+}
+
+void convertInt32ToInt16(const int32_t *input, int16_t *output, size_t samples) {
+    kernels().toInt16(input, output, samples);
+}
+
+DitherState::DitherState(size_t channelCount, uint32_t seed) : error(channelCount, 0) {
+    // Spread the seed over the lanes; xorshift32 must never hold 0.
+    uint32_t x = seed ? seed : 1;
+    for (auto &state: rng) {
+        x = x * 1664525u + 1013904223u;
+        state = x ? x : 1;
+    }
+}
+
+void convertInt32ToInt16Dither(const int32_t *input, int16_t *output, size_t samples, DitherState *state) {
+    kernels().toInt16Dither(input, output, samples, state->rng);
+}
+
+// First-order noise shaped dither of load(i, frame), the input sample i.
+// The error feedback is serial per channel, so this one stays scalar.
+template<typename Load>
+static void shapedDither(Load load, int16_t *output, size_t samples, DitherState *state) {
+    size_t channels = state->error.size();
+    assert(channels > 0 && samples % channels == 0);
+    int32_t *error = state->error.data();
+    uint32_t *rng = state->rng;
+    for (size_t i = 0, frame = 0; i < samples; i += channels, frame++) {
+        for (size_t ch = 0; ch < channels; ch++) {
+            auto &r = rng[ch % kDitherLanes];
+            r = xorshift32(r);
+            int32_t u1 = (int32_t) r >> 17;
+            int32_t u2 = (int32_t) (r << 16) >> 17;
+            // Units of 2^-15 LSB, as in ditherToInt16.
+            int32_t wanted = (load(i + ch, frame) >> 1) - error[ch];
+            int32_t q = (wanted + u1 + u2 + (1 << 14)) >> 15;
+            q = std::min(std::max(q, -32768), 32767);
+            // Limit the fed back error, so a clipped stretch can't wind it up.
+            error[ch] = std::min(std::max(q * (1 << 15) - wanted, -(1 << 17)), 1 << 17);
+            output[i + ch] = (int16_t) q;
+        }
+    }
+}
+
+void convertInt32ToInt16ShapedDither(const int32_t *input, int16_t *output, size_t samples, DitherState *state) {
+    shapedDither([&](size_t i, size_t) { return input[i]; }, output, samples, state);
+}
+
+void convertInt32ToInt24In32(const int32_t *input, int32_t *output, size_t samples) {
+    kernels().toInt24In32(input, output, samples);
+}
+
+void convertInt32ToFloat(const int32_t *input, float *output, size_t samples) {
+    kernels().toFloat(input, output, samples);
+}
+
+void convertAsioInt32ToMix(const int32_t *input, int32_t *output, size_t samples) {
+    kernels().asioToMix(input, output, samples);
+}
+
+void convertAsioInt32ToMixFloat(const int32_t *input, float *output, size_t samples) {
+    kernels().asioToMixFloat(input, output, samples);
+}
+
+void convertAsioToMix(AsioSampleFormat format, const void *input, int32_t *output, size_t samples) {
+    auto &k = kernels();
+    switch (format) {
+        case AsioSampleFormat::Int32LSB:
+            k.asioToMix(static_cast<const int32_t *>(input), output, samples);
+            break;
+        case AsioSampleFormat::Float32LSB:
+            k.asioFloat32ToMix(static_cast<const float *>(input), output, samples);
+            break;
+        case AsioSampleFormat::Int24LSB:
+            k.asioInt24ToMix(static_cast<const uint8_t *>(input), output, samples);
+            break;
+        case AsioSampleFormat::Int16LSB:
+            k.asioInt16ToMix(static_cast<const int16_t *>(input), output, samples);
+            break;
+    }
+}
+
+void convertAsioToMixFloat(AsioSampleFormat format, const void *input, float *output, size_t samples) {
+    auto &k = kernels();
+    switch (format) {
+        case AsioSampleFormat::Int32LSB:
+            k.asioToMixFloat(static_cast<const int32_t *>(input), output, samples);
+            break;
+        case AsioSampleFormat::Float32LSB:
+            k.asioFloat32ToMixFloat(static_cast<const float *>(input), output, samples);
+            break;
+        case AsioSampleFormat::Int24LSB:
+            k.asioInt24ToMixFloat(static_cast<const uint8_t *>(input), output, samples);
+            break;
+        case AsioSampleFormat::Int16LSB:
+            k.asioInt16ToMixFloat(static_cast<const int16_t *>(input), output, samples);
+            break;
+    }
+}
+
+void softClipInt24ToInt32(int32_t *samples, size_t count) {
+    kernels().softClip(samples, count);
+}
+
+void softClipFloatToInt32(const float *input, int32_t *output, size_t count) {
+    kernels().softClipFloat(input, output, count);
+}
+
+void interpolatedPeak(const float *input, float *peak, size_t count) {
+    kernels().interpolatedPeak(input, peak, count);
+}
+
+void convertInt32ToInt16Gain(const int32_t *input, int16_t *output, size_t samples, size_t channels, float gain,
+                             float step) {
+    kernels().toInt16Gain(input, output, samples, channels, gain, step);
+}
+
+void convertInt32ToInt16DitherGain(const int32_t *input, int16_t *output, size_t samples, size_t channels,
+                                   float gain, float step, DitherState *state) {
+    kernels().toInt16DitherGain(input, output, samples, channels, gain, step, state->rng);
+}
+
+void convertInt32ToInt16ShapedDitherGain(const int32_t *input, int16_t *output, size_t samples, float gain,
+                                         float step, DitherState *state) {
+    shapedDither([&](size_t i, size_t frame) { return applyGain(input[i], gain + (float) frame * step); },
+                 output, samples, state);
+}
+
+void convertInt32ToInt24In32Gain(const int32_t *input, int32_t *output, size_t samples, size_t channels,
+                                 float gain, float step) {
+    kernels().toInt24In32Gain(input, output, samples, channels, gain, step);
+}
+
+void convertInt32ToInt32Gain(const int32_t *input, int32_t *output, size_t samples, size_t channels, float gain,
+                             float step) {
+    kernels().toInt32Gain(input, output, samples, channels, gain, step);
+}
+
+void convertInt32ToFloatGain(const int32_t *input, float *output, size_t samples, size_t channels, float gain,
+                             float step) {
+    kernels().toFloatGain(input, output, samples, channels, gain, step);
+}
+
+void mixAddInt32(const int32_t *input, int32_t *output, size_t samples) {
+    kernels().mixAdd(input, output, samples);
+}
+
+void mixAddFloat(const float *input, float *output, size_t samples) {
+    kernels().mixAddFloat(input, output, samples);
+}
@@ -0,0 +1,175 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#ifndef TRGKASIO_SAMPLECONVERT_H
+#define TRGKASIO_SAMPLECONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "AudioEnums.h"
+
+/**
+ * Sample interleaving and format conversion kernels.
+ *
+ * Each kernel has a scalar, SSE2 and AVX2 version. The best one the CPU
+ * supports is picked on first use; `setSimdLevel` overrides it for tests
+ * and benchmarks. Every version gives bit-identical results.
+ */
+
+enum class SimdLevel {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+/// Best level this CPU supports.
+SimdLevel detectSimdLevel();
+
+/// Level the kernels currently use.
+SimdLevel simdLevel();
+
+/// Selects the kernels of `level`, clamped to `detectSimdLevel()`. Not thread safe.
+void setSimdLevel(SimdLevel level);
+
+const char *simdLevelName(SimdLevel level);
+
+/**
+ * Interleaves `frames` frames of planar `input`, starting at frame `offset`
+ * of each channel, into `output`. 2, 6 and 8 channels have dedicated kernels.
+ */
+void interleaveInt32(const std::vector<std::vector<int32_t>> &input, size_t offset, size_t frames,
+                     int32_t *output);
+
+/// 32-bit samples to 16-bit, keeping the upper 16 bits.
+void convertInt32ToInt16(const int32_t *input, int16_t *output, size_t samples);
+
+constexpr size_t kDitherLanes = 8;
+
+/// Dither state of one 16-bit output. Keep one per device.
+struct DitherState {
+    explicit DitherState(size_t channelCount = 0, uint32_t seed = 1);
+
+    uint32_t rng[kDitherLanes];  // xorshift32 states
+    std::vector<int32_t> error;  // noise shaping error per channel
+};
+
+/**
+ * 32-bit samples to 16-bit with TPDF dither: the sum of two uniform random
+ * values of one LSB each is added before rounding. Continues the random
+ * sequence in `state` across calls.
+ */
+void convertInt32ToInt16Dither(const int32_t *input, int16_t *output, size_t samples, DitherState *state);
+
+/**
+ * Same as convertInt32ToInt16Dither, with first-order noise shaping: each
+ * channel's rounding error is subtracted from its next sample, moving the
+ * noise to high frequencies. `samples` must be whole frames of
+ * `state->error.size()` interleaved channels.
+ */
+void convertInt32ToInt16ShapedDither(const int32_t *input, int16_t *output, size_t samples, DitherState *state);
+
+/// 32-bit samples to 24 valid bits in a 32-bit container. The low 8 bits are cleared.
+void convertInt32ToInt24In32(const int32_t *input, int32_t *output, size_t samples);
+
+/// 32-bit samples to IEEE float in [-1, 1).
+void convertInt32ToFloat(const int32_t *input, float *output, size_t samples);
+
+/**
+ * Output conversions with a gain. Each sample is scaled by the gain of its
+ * frame, rounded and saturated to 32 bits, then converted like the version
+ * without gain. Frame f of the `channels` interleaved channels gets
+ * `gain + f * step`. Constant gain (step 0) has SIMD versions; ramps run
+ * scalar code.
+ */
+void convertInt32ToInt16Gain(const int32_t *input, int16_t *output, size_t samples, size_t channels, float gain,
+                             float step);
+
+void convertInt32ToInt16DitherGain(const int32_t *input, int16_t *output, size_t samples, size_t channels,
+                                   float gain, float step, DitherState *state);
+
+/// The channel count is `state->error.size()`.
+void convertInt32ToInt16ShapedDitherGain(const int32_t *input, int16_t *output, size_t samples, float gain,
+                                         float step, DitherState *state);
+
+void convertInt32ToInt24In32Gain(const int32_t *input, int32_t *output, size_t samples, size_t channels,
+                                 float gain, float step);
+
+void convertInt32ToInt32Gain(const int32_t *input, int32_t *output, size_t samples, size_t channels, float gain,
+                             float step);
+
+void convertInt32ToFloatGain(const int32_t *input, float *output, size_t samples, size_t channels, float gain,
+                             float step);
+
+/**
+ * ASIO input to mix bus samples: scales 32-bit to 24-bit and multiplies by
+ * 15/16, leaving headroom for the clap sounds and the soft clipper.
+ */
+void convertAsioInt32ToMix(const int32_t *input, int32_t *output, size_t samples);
+
+/// ASIO input to float mix bus samples, where 1.0 is full scale. Same 15/16 gain as the integer mix bus.
+void convertAsioInt32ToMixFloat(const int32_t *input, float *output, size_t samples);
+
+/**
+ * ASIO input in `format` to mix bus samples. Every format gets the same
+ * headroom scaling as convertAsioInt32ToMix; float input is clamped to
+ * 128 times full scale.
+ */
+void convertAsioToMix(AsioSampleFormat format, const void *input, int32_t *output, size_t samples);
+
+/// ASIO input in `format` to float mix bus samples. Float input only gets the 15/16 gain.
+void convertAsioToMixFloat(AsioSampleFormat format, const void *input, float *output, size_t samples);
+
+/// Adds `input` to `output` sample by sample, wrapping on overflow. Mixes a mono signal into a bus channel.
+void mixAddInt32(const int32_t *input, int32_t *output, size_t samples);
+
+void mixAddFloat(const float *input, float *output, size_t samples);
+
+/**
+ * Soft clips 24-bit mix bus samples in place and scales them to 32-bit.
+ *
+ * Samples within +-kSoftClipThreshold pass through unchanged. Above it the
+ * overflow is compressed into the remaining kSoftClipPadding with
+ * `kSoftClipPadding * tanh(overflow / (2 * kSoftClipPadding))`, evaluated
+ * from a linearly interpolated table to within 1 LSB (24-bit). The output
+ * never exceeds the 24-bit range before scaling.
+ */
+void softClipInt24ToInt32(int32_t *samples, size_t count);
+
+/**
+ * Soft clips float mix bus samples into 32-bit output. Same curve as
+ * softClipInt24ToInt32, scaled so that 1.0 is full scale, without rounding
+ * the input to 24 bits first.
+ */
+void softClipFloatToInt32(const float *input, int32_t *output, size_t count);
+
+/**
+ * Sample and inter-sample peak detection for a true-peak limiter.
+ *
+ * peak[i] = max(peak[i], |input[i]|, |x(t)|) for t in (i - 1, i + 1), where
+ * x(t) is `input` oversampled 4x with a short windowed sinc. Reads
+ * input[-4] through input[count + 3].
+ */
+void interpolatedPeak(const float *input, float *peak, size_t count);
+
+constexpr int32_t kSoftClipPadding = (1 << 19) - 5;
+constexpr int32_t kSoftClipThreshold = (1 << 23) - kSoftClipPadding - 5;
+
+#endif //TRGKASIO_SAMPLECONVERT_H
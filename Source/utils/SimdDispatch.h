@@ -0,0 +1,64 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Helpers for SIMD kernel translation units. Not for use in headers that
+// other code includes: AVX2 functions must stay behind runtime dispatch.
+
+#pragma once
+
+#ifndef TRGKASIO_SIMDDISPATCH_H
+#define TRGKASIO_SIMDDISPATCH_H
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TRGKASIO_SIMD_X86
+
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// MSVC emits any intrinsic as is; gcc and clang need the ISA enabled per function.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TRGKASIO_TARGET_AVX2
+#else
+#define TRGKASIO_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/// AVX2 supported by both the CPU and the OS (YMM state saved on context switch).
+inline bool cpuHasAVX2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return false;
+    if ((_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+#endif //TRGKASIO_SIMDDISPATCH_H
@@ -0,0 +1,102 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "UnderrunConcealer.h"
+#include <algorithm>
+#include <cstring>
+
+UnderrunConcealer::UnderrunConcealer(size_t channelCount, size_t maxFrames, size_t fadeFrames)
+        : _channelCount(channelCount),
+          _fadeFrames(fadeFrames),
+          _history(fadeFrames * channelCount, 0),
+          _tail(fadeFrames * channelCount, 0),
+          _scratch(maxFrames * channelCount, 0) {}
+
+void UnderrunConcealer::appendHistory(const int32_t *frames, size_t count) {
+    if (count == 0) return;
+    if (count >= _fadeFrames) {
+        frames += (count - _fadeFrames) * _channelCount;
+        count = _fadeFrames;
+    }
+    size_t firstCount = std::min(count, _fadeFrames - _historyEnd);
+    memcpy(_history.data() + _historyEnd * _channelCount, frames, firstCount * _channelCount * sizeof(int32_t));
+    memcpy(_history.data(), frames + firstCount * _channelCount,
+           (count - firstCount) * _channelCount * sizeof(int32_t));
+    _historyEnd = (_historyEnd + count) % _fadeFrames;
+}
+
+RingSpans<const int32_t> UnderrunConcealer::deliver(const RingSpans<const int32_t> &spans, size_t frames) {
+    size_t firstFrames = std::min(frames, spans.firstSize);
+    if (_concealing) {
+        _concealing = false;
+        _recovering = true;
+        _fadeInPos = 0;
+    }
+
+    if (!_recovering) {
+        appendHistory(spans.first, firstFrames);
+        appendHistory(spans.second, frames - firstFrames);
+        return spans;
+    }
+
+    for (size_t i = 0; i < frames; i++) {
+        const int32_t *in = i < firstFrames ? spans.first + i * _channelCount
+                                            : spans.second + (i - firstFrames) * _channelCount;
+        int32_t *out = _scratch.data() + i * _channelCount;
+        if (_fadeInPos < _fadeFrames) {
+            for (size_t ch = 0; ch < _channelCount; ch++) {
+                int64_t s = (int64_t) in[ch] * (int64_t) (_fadeInPos + 1) / (int64_t) _fadeFrames +
+                            tailSample(_tailPos, ch);
+                out[ch] = (int32_t) std::clamp<int64_t>(s, INT32_MIN, INT32_MAX);
+            }
+            _fadeInPos++;
+            _tailPos = std::min(_tailPos + 1, _fadeFrames);
+        } else {
+            memcpy(out, in, _channelCount * sizeof(int32_t));
+        }
+    }
+    if (_fadeInPos == _fadeFrames) _recovering = false;
+
+    appendHistory(_scratch.data(), frames);
+    return {_scratch.data(), frames, nullptr, 0};
+}
+
+RingSpans<const int32_t> UnderrunConcealer::conceal(size_t frames) {
+    _concealedBlocks.fetch_add(1, std::memory_order_relaxed);
+    if (!_concealing) {
+        // Played backwards from the last frame, the waveform stays continuous.
+        for (size_t k = 0; k < _fadeFrames; k++) {
+            size_t frame = (_historyEnd + _fadeFrames - 1 - k) % _fadeFrames;
+            memcpy(_tail.data() + k * _channelCount, _history.data() + frame * _channelCount,
+                   _channelCount * sizeof(int32_t));
+        }
+        _concealing = true;
+        _recovering = false;
+        _tailPos = 0;
+    }
+
+    for (size_t i = 0; i < frames; i++) {
+        int32_t *out = _scratch.data() + i * _channelCount;
+        for (size_t ch = 0; ch < _channelCount; ch++) out[ch] = (int32_t) tailSample(_tailPos, ch);
+        _tailPos = std::min(_tailPos + 1, _fadeFrames);
+    }
+    // The history is what the device played, so the next tail is continuous too.
+    appendHistory(_scratch.data(), frames);
+    return {_scratch.data(), frames, nullptr, 0};
+}
@@ -0,0 +1,86 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#ifndef TRGKASIO_UNDERRUNCONCEALER_H
+#define TRGKASIO_UNDERRUNCONCEALER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "RingBuffer.h"
+
+/**
+ * Hides output ring underruns from the listener.
+ *
+ * When the ring can't fill a device buffer, the last delivered audio is
+ * played backwards from the point it stopped, fading out, so the waveform
+ * continues without a jump. When data comes back it fades in, crossfading
+ * with whatever is left of the fade out. Works on interleaved int32 frames,
+ * before DeviceWriter converts them. All memory is allocated up front.
+ */
+class UnderrunConcealer {
+public:
+    static constexpr double kFadeMs = 5;
+
+    /// `fadeFrames` must be at least 1.
+    UnderrunConcealer(size_t channelCount, size_t maxFrames, size_t fadeFrames);
+
+    /**
+     * Frames the ring delivered. Returns `spans` as they are, or a faded in
+     * copy right after an underrun. Only the first `frames` frames of the
+     * result are valid. `frames` must not exceed maxFrames.
+     */
+    RingSpans<const int32_t> deliver(const RingSpans<const int32_t> &spans, size_t frames);
+
+    /// Returns `frames` frames to play instead of the missing ones. `frames` must not exceed maxFrames.
+    RingSpans<const int32_t> conceal(size_t frames);
+
+    /// Blocks filled by conceal(). May be read from any thread.
+    [[nodiscard]] uint64_t concealedBlocks() const { return _concealedBlocks.load(std::memory_order_relaxed); }
+
+private:
+    void appendHistory(const int32_t *frames, size_t count);
+
+    /// Channel `ch` of frame `pos` of the fade out.
+    [[nodiscard]] int64_t tailSample(size_t pos, size_t ch) const {
+        if (pos >= _fadeFrames) return 0;
+        return (int64_t) _tail[pos * _channelCount + ch] * (int64_t) (_fadeFrames - pos) / (int64_t) _fadeFrames;
+    }
+
+private:
+    size_t _channelCount;
+    size_t _fadeFrames;
+
+    std::vector<int32_t> _history;  // last _fadeFrames frames played, circular
+    size_t _historyEnd = 0;
+    std::vector<int32_t> _tail;  // history at the underrun, newest frame first
+    std::vector<int32_t> _scratch;  // behind the const spans deliver() and conceal() return
+
+    bool _concealing = false;
+    bool _recovering = false;
+    size_t _tailPos = 0;
+    size_t _fadeInPos = 0;
+
+    std::atomic<uint64_t> _concealedBlocks{0};
+};
+
+#endif //TRGKASIO_UNDERRUNCONCEALER_H
@@ -23,6 +23,7 @@
 #include "WaveLoad.h"
 
 #include <vector>
+#include <algorithm>
 #include <mmsystem.h>
 
 /////// IDK the use case, but user MAY replace clap sound resource
@@ -35,25 +36,27 @@ static const BYTE *findChunk(
         size_t *size) {
     const BYTE *p = pStart;
     while (true) {
-        runtime_check(p + 8 <= pEnd, "Cannot find '{}' section", headerName);
+        runtime_check(pEnd - p >= 8, "Cannot find '{}' section", headerName);
         auto chunkSize = *reinterpret_cast<const uint32_t *>(p + 4);
+        runtime_check(chunkSize <= (size_t) (pEnd - p - 8), "Section size past end of file: {}", chunkSize);
         if (memcmp(p, headerName, 4) == 0) {
             if (size) *size = chunkSize;
             return p + 8;
         }
-        runtime_check(chunkSize <= 0x7fffffff, "Section size too big: {}", chunkSize);
-        p += 8 + chunkSize;
+        // Odd-sized chunks are followed by a pad byte, which may be missing at the end of the file.
+        size_t advance = 8 + (size_t) chunkSize + (chunkSize & 1);
+        p += std::min(advance, (size_t) (pEnd - p));
     }
 }
 
-WaveSound loadWaveSound(const std::vector<BYTE> &content, int targetSampleRate) {
-    const auto resourceSize = content.size();
-    const BYTE *riffEnd = content.data() + resourceSize;
+WaveSound loadWaveSound(const uint8_t *content, size_t size, int targetSampleRate) {
+    const auto resourceSize = size;
+    const BYTE *riffEnd = content + resourceSize;
     runtime_check(resourceSize > 12, "Not a valid RIFF file");
-    runtime_check(memcmp(content.data(), "RIFF", 4) == 0, "Not a valid RIFF file");
-    runtime_check(memcmp(content.data() + 8, "WAVE", 4) == 0, "Not a valid WAVE file");
+    runtime_check(memcmp(content, "RIFF", 4) == 0, "Not a valid RIFF file");
+    runtime_check(memcmp(content + 8, "WAVE", 4) == 0, "Not a valid WAVE file");
 
-    auto riffStart = content.data() + 12;
+    auto riffStart = content + 12;
 
     // find "fmt " tag
     size_t fmtSize;
@@ -61,6 +64,8 @@ WaveSound loadWaveSound(const std::vector<BYTE> &content, int targetSampleRate)
     runtime_check(fmtSize >= sizeof(WAVEFORMAT), "Invalid fmt section");
     WAVEFORMAT format;
     memcpy(&format, fmtP, sizeof(WAVEFORMAT));
+    runtime_check(format.wFormatTag == WAVE_FORMAT_PCM, "Only PCM clap sound supported (format {})", format.wFormatTag);
+    runtime_check(format.nSamplesPerSec != 0, "Invalid sample rate 0");
     runtime_check(format.nChannels == 1 && format.nBlockAlign == 2, "Only mono & 16bit clap sound supported");
 
     //find "data" tag
@@ -23,6 +23,8 @@
 #ifndef TRGKASIO_WAVELOAD_H
 #define TRGKASIO_WAVELOAD_H
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 struct WaveSound {
@@ -30,7 +32,12 @@ struct WaveSound {
     std::vector<double> audio;
 };
 
-WaveSound loadWaveSound(const std::vector<BYTE> &content, int targetSampleRate);
+/// Decodes a mono 16-bit WAV file and resamples it to `targetSampleRate`.
+WaveSound loadWaveSound(const uint8_t *content, size_t size, int targetSampleRate);
+
+inline WaveSound loadWaveSound(const std::vector<uint8_t> &content, int targetSampleRate) {
+    return loadWaveSound(content.data(), content.size(), targetSampleRate);
+}
 
 
 #endif //TRGKASIO_WAVELOAD_H
@@ -0,0 +1,362 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Per-block DSP stage microbenchmarks.
+//
+//   bench_dsp [--json] [--quick]
+//
+// Runs each stage of RunningState::threadProc on one ASIO block at a time,
+// for every SIMD level the CPU supports, and prints cycles (TSC ticks on
+// x86) and nanoseconds per frame as CSV, or JSON with --json. Soft clipping
+// runs on silence and on loud material (peaks at twice full scale), and the
+// clipper it replaced is measured for comparison. The `_float` cases are the
+// same stages on the float mix bus. `device_write_*` is LoadData's copy into
+// the device buffer through DeviceWriter. `device_write_int16_*` with a dither name is the 16-bit write with that dither mode, and
+// `device_write_*_gain` the write at a constant gain other than unity.
+// `clap_mix` adds 16 sounding claps from their baked tables to the integer
+// mix bus, mixed once and added to every channel, and `clap_mix_per_channel`
+// is the per-channel rescaling it replaced.
+
+#include "../Source/utils/SampleConvert.h"
+#include "../Source/utils/DeviceWriter.h"
+#include "../Source/utils/LookaheadLimiter.h"
+#include "../Source/utils/ClapTable.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TRGKASIO_HAS_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TRGKASIO_HAS_RDTSC
+#endif
+
+using Clock = std::chrono::steady_clock;
+using PlanarBuffer = std::vector<std::vector<int32_t>>;
+
+struct DspResult {
+    std::string bench;
+    std::string simd;
+    size_t channels = 0;
+    size_t frames = 0;
+    size_t blocks = 0;
+    double cyclesPerFrame = 0;
+    double nsPerFrame = 0;
+};
+
+static bool g_quick = false;
+
+static uint64_t cycles() {
+#ifdef TRGKASIO_HAS_RDTSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static PlanarBuffer randomBlock(size_t channels, size_t frames, int32_t amplitude, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int32_t> dist(-amplitude, amplitude);
+    PlanarBuffer block(channels, std::vector<int32_t>(frames));
+    for (auto &ch: block) {
+        for (auto &s: ch) s = dist(rng);
+    }
+    return block;
+}
+
+/// Runs `processBlock` repeatedly and reports per-frame cost.
+static DspResult measure(const std::string &bench, size_t channels, size_t frames,
+                         const std::function<void()> &processBlock) {
+    size_t blocks = std::max<size_t>(64, (g_quick ? (1 << 20) : (1 << 24)) / (frames * channels));
+    for (size_t i = 0; i < blocks / 8; i++) processBlock();  // warm up
+
+    auto startTime = Clock::now();
+    auto startCycles = cycles();
+    for (size_t i = 0; i < blocks; i++) processBlock();
+    auto endCycles = cycles();
+    auto endTime = Clock::now();
+
+    double totalFrames = (double) blocks * frames;
+    DspResult r;
+    r.bench = bench;
+    r.simd = simdLevelName(simdLevel());
+    r.channels = channels;
+    r.frames = frames;
+    r.blocks = blocks;
+    r.cyclesPerFrame = (double) (endCycles - startCycles) / totalFrames;
+    r.nsPerFrame = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            endTime - startTime).count() / totalFrames;
+    return r;
+}
+
+/////
+
+/// "Polling ASIO data": ASIO buffers to the mix bus.
+static DspResult benchAsioIngest(size_t channels, size_t frames) {
+    auto asio = randomBlock(channels, frames, INT32_MAX, 1);
+    PlanarBuffer mix(channels, std::vector<int32_t>(frames));
+    return measure("asio_ingest", channels, frames, [&]() {
+        for (size_t ch = 0; ch < channels; ch++) {
+            convertAsioInt32ToMix(asio[ch].data(), mix[ch].data(), frames);
+        }
+    });
+}
+
+static DspResult benchAsioIngestFloat(size_t channels, size_t frames) {
+    auto asio = randomBlock(channels, frames, INT32_MAX, 1);
+    std::vector<std::vector<float>> mix(channels, std::vector<float>(frames));
+    return measure("asio_ingest_float", channels, frames, [&]() {
+        for (size_t ch = 0; ch < channels; ch++) {
+            convertAsioInt32ToMixFloat(asio[ch].data(), mix[ch].data(), frames);
+        }
+    });
+}
+
+// compress24bitTo32bit before the table based clipper, for comparison.
+static void legacyCompress(PlanarBuffer *outputBuffer) {
+    const int32_t overflowPreventer = 5;
+    const int32_t compressPadding = (1 << 19) - overflowPreventer;
+    const int32_t compressionThresholdHigh =
+            (1 << 23) - compressPadding - overflowPreventer;
+    const int32_t compressionThresholdLow = -compressionThresholdHigh;
+
+    for (auto &channelBuffer: *outputBuffer) {
+        for (auto &sample: channelBuffer) {
+            int32_t o;
+            if (sample > compressionThresholdHigh) {
+                auto overflow = sample - compressionThresholdHigh;
+                o = compressionThresholdHigh + (int32_t) round(
+                        compressPadding * (2 / (1 + exp(-overflow / compressPadding)) - 1));
+            } else if (sample < compressionThresholdLow) {
+                auto overflow = sample - compressionThresholdLow;
+                o = compressionThresholdLow + (int32_t) round(
+                        compressPadding * (2 / (1 + exp(-overflow / compressPadding)) - 1));
+            } else {
+                o = sample;
+            }
+            sample = (o << 8);
+        }
+    }
+}
+
+/// Soft clipping of a mix bus block. `amplitude` is the peak level before clipping.
+static DspResult benchSoftClip(size_t channels, size_t frames, const char *material, int32_t amplitude,
+                               bool legacy) {
+    auto source = randomBlock(channels, frames, amplitude, 2);
+    auto mix = source;
+    auto name = std::string(legacy ? "soft_clip_legacy_" : "soft_clip_") + material;
+    return measure(name, channels, frames, [&]() {
+        // Restoring the input is part of every case, so the cases stay comparable.
+        for (size_t ch = 0; ch < channels; ch++) {
+            std::copy(source[ch].begin(), source[ch].end(), mix[ch].begin());
+        }
+        if (legacy) {
+            legacyCompress(&mix);
+        } else {
+            for (auto &ch: mix) softClipInt24ToInt32(ch.data(), ch.size());
+        }
+    });
+}
+
+static DspResult benchSoftClipFloat(size_t channels, size_t frames, const char *material, int32_t amplitude) {
+    auto source = randomBlock(channels, frames, amplitude, 2);
+    std::vector<std::vector<float>> mix(channels, std::vector<float>(frames));
+    for (size_t ch = 0; ch < channels; ch++) {
+        for (size_t i = 0; i < frames; i++) mix[ch][i] = (float) source[ch][i] / (1 << 23);
+    }
+    PlanarBuffer out(channels, std::vector<int32_t>(frames));
+    return measure(std::string("soft_clip_float_") + material, channels, frames, [&]() {
+        for (size_t ch = 0; ch < channels; ch++) {
+            softClipFloatToInt32(mix[ch].data(), out[ch].data(), frames);
+        }
+    });
+}
+
+/// Lookahead limiter on a float mix bus block, 1ms lookahead.
+static DspResult benchLimiter(size_t channels, size_t frames, const char *material, int32_t amplitude) {
+    auto source = randomBlock(channels, frames, amplitude, 5);
+    std::vector<std::vector<float>> mix(channels, std::vector<float>(frames));
+    LookaheadLimiter limiter(channels, 48000, 1.0, frames);
+    return measure(std::string("limiter_") + material, channels, frames, [&]() {
+        for (size_t ch = 0; ch < channels; ch++) {
+            for (size_t i = 0; i < frames; i++) mix[ch][i] = (float) source[ch][i] / (1 << 23);
+        }
+        limiter.process(&mix);
+    });
+}
+
+/// Device buffer write of one block from wrapped ring spans.
+static DspResult benchDeviceWrite(size_t channels, size_t frames, DeviceSampleFormat format, const char *formatName) {
+    // Split the block like a heap ring right after the wrap point.
+    size_t firstFrames = frames / 3;
+    auto first = randomBlock(1, firstFrames * channels, INT32_MAX, 3);
+    auto second = randomBlock(1, (frames - firstFrames) * channels, INT32_MAX, 4);
+    RingSpans<const int32_t> spans{first[0].data(), firstFrames, second[0].data(), frames - firstFrames};
+    std::vector<uint8_t> out(frames * channels * deviceSampleSize(format));
+    DeviceWriter writer(format, channels);
+
+    return measure(std::string("device_write_") + formatName, channels, frames, [&]() {
+        writer.write(spans, frames, out.data());
+    });
+}
+
+/// 16-bit device buffer write with dither.
+static DspResult benchDeviceWriteDither(size_t channels, size_t frames, DitherMode dither, const char *ditherName) {
+    size_t firstFrames = frames / 3;
+    auto first = randomBlock(1, firstFrames * channels, INT32_MAX, 3);
+    auto second = randomBlock(1, (frames - firstFrames) * channels, INT32_MAX, 4);
+    RingSpans<const int32_t> spans{first[0].data(), firstFrames, second[0].data(), frames - firstFrames};
+    std::vector<int16_t> out(frames * channels);
+    DeviceWriter writer(DeviceSampleFormat::Int16, channels, dither);
+
+    return measure(std::string("device_write_int16_") + ditherName, channels, frames, [&]() {
+        writer.write(spans, frames, out.data());
+    });
+}
+
+/// Device buffer write at -6dB, after the gain ramp has settled.
+static DspResult benchDeviceWriteGain(size_t channels, size_t frames, DeviceSampleFormat format,
+                                      const char *formatName) {
+    size_t firstFrames = frames / 3;
+    auto first = randomBlock(1, firstFrames * channels, INT32_MAX, 3);
+    auto second = randomBlock(1, (frames - firstFrames) * channels, INT32_MAX, 4);
+    RingSpans<const int32_t> spans{first[0].data(), firstFrames, second[0].data(), frames - firstFrames};
+    std::vector<uint8_t> out(frames * channels * deviceSampleSize(format));
+    DeviceWriter writer(format, channels);
+    writer.setGainRampFrames(1);
+    writer.write(spans, frames, out.data(), 0.5f);
+
+    return measure(std::string("device_write_") + formatName + "_gain", channels, frames, [&]() {
+        writer.write(spans, frames, out.data(), 0.5f);
+    });
+}
+
+/// "Add clap sound" with `voices` claps at different positions in their sound.
+static DspResult benchClapMix(size_t channels, size_t frames, bool perChannel) {
+    const size_t voices = 16;
+    const double gain = 0.5;
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> sound(frames * 64);
+    for (auto &s: sound) s = dist(rng);
+    std::vector<size_t> offsets(voices);
+    for (size_t v = 0; v < voices; v++) offsets[v] = v * frames * 3;
+
+    ClapTable<int32_t> table;
+    table.bake(sound, gain);
+
+    PlanarBuffer mix(channels, std::vector<int32_t>(frames));
+    std::vector<int32_t> clapMix(frames);
+    return measure(perChannel ? "clap_mix_per_channel" : "clap_mix", channels, frames, [&]() {
+        if (perChannel) {
+            for (auto offset: offsets) {
+                for (auto &channel: mix) {
+                    for (size_t i = 0; i < frames; i++) {
+                        channel[i] += (int32_t) round((double) sound[offset + i] * gain * (1 << 24));
+                    }
+                }
+            }
+        } else {
+            table.bake(sound, gain);
+            std::fill(clapMix.begin(), clapMix.end(), 0);
+            for (auto offset: offsets) table.mix((int64_t) offset, clapMix.data(), frames);
+            for (auto &channel: mix) mixAddInt32(clapMix.data(), channel.data(), frames);
+        }
+    });
+}
+
+static void printCsv(const std::vector<DspResult> &results) {
+    printf("bench,simd,channels,frames,blocks,cycles_per_frame,ns_per_frame\n");
+    for (const auto &r: results) {
+        printf("%s,%s,%zu,%zu,%zu,%.2f,%.3f\n", r.bench.c_str(), r.simd.c_str(), r.channels, r.frames,
+               r.blocks, r.cyclesPerFrame, r.nsPerFrame);
+    }
+}
+
+static void printJson(const std::vector<DspResult> &results) {
+    printf("[\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &r = results[i];
+        printf("  {\"bench\": \"%s\", \"simd\": \"%s\", \"channels\": %zu, \"frames\": %zu, \"blocks\": %zu, "
+               "\"cycles_per_frame\": %.2f, \"ns_per_frame\": %.3f}%s\n",
+               r.bench.c_str(), r.simd.c_str(), r.channels, r.frames, r.blocks, r.cyclesPerFrame, r.nsPerFrame,
+               i + 1 < results.size() ? "," : "");
+    }
+    printf("]\n");
+}
+
+int main(int argc, char **argv) {
+    bool json = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) json = true;
+        else if (strcmp(argv[i], "--quick") == 0) g_quick = true;
+        else {
+            fprintf(stderr, "Usage: %s [--json] [--quick]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<DspResult> results;
+    for (auto level: {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+        if ((int) level > (int) detectSimdLevel()) break;
+        setSimdLevel(level);
+        for (size_t channels: {2, 8}) {
+            for (size_t frames: {64, 256, 1024}) {
+                results.push_back(benchAsioIngest(channels, frames));
+                results.push_back(benchSoftClip(channels, frames, "silence", 0, false));
+                results.push_back(benchSoftClip(channels, frames, "loud", 1 << 24, false));
+                results.push_back(benchAsioIngestFloat(channels, frames));
+                results.push_back(benchSoftClipFloat(channels, frames, "silence", 0));
+                results.push_back(benchSoftClipFloat(channels, frames, "loud", 1 << 24));
+                results.push_back(benchLimiter(channels, frames, "silence", 0));
+                results.push_back(benchLimiter(channels, frames, "loud", 1 << 24));
+                results.push_back(benchDeviceWrite(channels, frames, DeviceSampleFormat::Int16, "int16"));
+                results.push_back(benchDeviceWrite(channels, frames, DeviceSampleFormat::Int24In32, "int24in32"));
+                results.push_back(benchDeviceWrite(channels, frames, DeviceSampleFormat::Int32, "int32"));
+                results.push_back(benchDeviceWrite(channels, frames, DeviceSampleFormat::Float32, "float32"));
+                results.push_back(benchDeviceWriteDither(channels, frames, DitherMode::Tpdf, "tpdf"));
+                results.push_back(benchDeviceWriteDither(channels, frames, DitherMode::Shaped, "shaped"));
+                results.push_back(benchDeviceWriteGain(channels, frames, DeviceSampleFormat::Int16, "int16"));
+                results.push_back(benchDeviceWriteGain(channels, frames, DeviceSampleFormat::Int32, "int32"));
+                results.push_back(benchDeviceWriteGain(channels, frames, DeviceSampleFormat::Float32, "float32"));
+                results.push_back(benchClapMix(channels, frames, false));
+            }
+        }
+    }
+    // The legacy clipper and clap rendering are scalar code, so one pass is enough.
+    setSimdLevel(SimdLevel::Scalar);
+    for (size_t channels: {2, 8}) {
+        for (size_t frames: {64, 256, 1024}) {
+            results.push_back(benchSoftClip(channels, frames, "silence", 0, true));
+            results.push_back(benchSoftClip(channels, frames, "loud", 1 << 24, true));
+            results.push_back(benchClapMix(channels, frames, true));
+        }
+    }
+
+    if (json) printJson(results);
+    else printCsv(results);
+    return 0;
+}
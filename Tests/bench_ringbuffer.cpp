@@ -0,0 +1,265 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Ring buffer microbenchmarks.
+//
+//   bench_ringbuffer [--json] [--quick]
+//
+// Prints one CSV row (or JSON object) per case:
+// - throughput: push + get of one block on a single thread, for each ring
+//   kind, sample type, channel count and block size. `wrap` cases start half
+//   a block in, so every fourth block straddles the end of the storage.
+// - latency: time from `push` on one thread until `get` succeeds on another,
+//   through the BroadcastRingBuffer that carries samples to WASAPIOutputEvent.
+
+#include "../Source/utils/RingBuffer.h"
+#include "../Source/utils/BroadcastRingBuffer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchResult {
+    std::string bench;
+    std::string ring;
+    std::string type;
+    size_t channels = 0;
+    size_t frames = 0;
+    std::string layout;
+    size_t blocks = 0;
+    double nsPerBlock = 0;
+    double mframesPerSec = 0;
+    double p50Ns = 0;
+    double p99Ns = 0;
+    double maxNs = 0;
+};
+
+static bool g_quick = false;
+
+// Keeps the compiler from dropping reads nobody looks at.
+static volatile uint64_t g_sink;
+
+template<typename T>
+static const char *typeName();
+
+template<>
+const char *typeName<int32_t>() { return "int32"; }
+
+template<>
+const char *typeName<float>() { return "float"; }
+
+/////
+
+template<typename T>
+struct PlainRing {
+    static constexpr const char *name = "RingBuffer";
+    RingBuffer<T> ring;
+
+    PlainRing(size_t capacity, size_t channels) : ring(capacity, channels) {}
+
+    bool push(const T *p, size_t n) { return ring.push(p, n); }
+
+    bool get(T *p, size_t n) { return ring.get(p, n); }
+};
+
+template<typename T>
+struct PowerOfTwoRing {
+    static constexpr const char *name = "PowerOfTwoRingBuffer";
+    PowerOfTwoRingBuffer<T> ring;
+
+    PowerOfTwoRing(size_t capacity, size_t channels) : ring(capacity, channels) {}
+
+    bool push(const T *p, size_t n) { return ring.push(p, n); }
+
+    bool get(T *p, size_t n) { return ring.get(p, n); }
+};
+
+template<typename T>
+struct MirroredBroadcastRing {
+    static constexpr const char *name = "BroadcastRingBuffer(mirrored)";
+    BroadcastRingBuffer<T> ring;
+
+    MirroredBroadcastRing(size_t capacity, size_t channels)
+            : ring(capacity, channels, 1, RingBufferStorage::Mirrored) {}
+
+    bool push(const T *p, size_t n) { return ring.push(p, n); }
+
+    bool get(T *p, size_t n) { return ring.get(0, p, n); }
+};
+
+template<typename Ring, typename T>
+static BenchResult benchThroughput(size_t channels, size_t frames, bool wrap) {
+    Ring ring(frames * 4, channels);
+    std::vector<T> in(frames * channels), out(frames * channels);
+    for (size_t i = 0; i < in.size(); i++) in[i] = (T) i;
+
+    if (wrap) {
+        // Offset every block by half a block against the storage end.
+        ring.push(in.data(), frames / 2);
+    }
+
+    // Roughly the same amount of samples per case.
+    size_t blocks = std::max<size_t>(64, (g_quick ? (1 << 20) : (1 << 24)) / (frames * channels));
+    for (size_t i = 0; i < blocks / 8; i++) {  // warm up
+        ring.push(in.data(), frames);
+        ring.get(out.data(), frames);
+    }
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < blocks; i++) {
+        ring.push(in.data(), frames);
+        ring.get(out.data(), frames);
+    }
+    auto end = Clock::now();
+    g_sink = g_sink + (uint64_t) out[frames / 2];
+
+    double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    BenchResult r;
+    r.bench = "throughput";
+    r.ring = Ring::name;
+    r.type = typeName<T>();
+    r.channels = channels;
+    r.frames = frames;
+    r.layout = wrap ? "wrap" : "nowrap";
+    r.blocks = blocks;
+    r.nsPerBlock = ns / blocks;
+    r.mframesPerSec = (double) blocks * frames / ns * 1000;
+    return r;
+}
+
+/// Ping-pong one block at a time between two threads and time each handoff.
+static BenchResult benchHandoffLatency(size_t channels, size_t frames) {
+    const size_t blocks = g_quick ? 1000 : 20000;
+    BroadcastRingBuffer<int32_t> ring(frames * 4, channels, 1, RingBufferStorage::Mirrored);
+    std::vector<Clock::time_point> pushTime(blocks);
+    std::vector<double> latency(blocks);
+    std::atomic<size_t> consumed{0};
+
+    std::thread consumer([&]() {
+        std::vector<int32_t> out(frames * channels);
+        for (size_t i = 0; i < blocks; i++) {
+            while (!ring.get(0, out.data(), frames)) {
+                std::this_thread::yield();
+            }
+            auto now = Clock::now();
+            // pushTime[i] was written before the push that released this block.
+            latency[i] = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    now - pushTime[i]).count();
+            consumed.store(i + 1, std::memory_order_release);
+        }
+    });
+
+    std::vector<int32_t> in(frames * channels);
+    for (size_t i = 0; i < blocks; i++) {
+        while (consumed.load(std::memory_order_acquire) < i) {
+            std::this_thread::yield();
+        }
+        pushTime[i] = Clock::now();
+        ring.push(in.data(), frames);
+    }
+    consumer.join();
+
+    std::sort(latency.begin(), latency.end());
+    BenchResult r;
+    r.bench = "latency";
+    r.ring = "BroadcastRingBuffer(mirrored)";
+    r.type = "int32";
+    r.channels = channels;
+    r.frames = frames;
+    r.layout = "nowrap";
+    r.blocks = blocks;
+    r.p50Ns = latency[blocks / 2];
+    r.p99Ns = latency[blocks * 99 / 100];
+    r.maxNs = latency.back();
+    return r;
+}
+
+/////
+
+template<typename T>
+static void benchType(std::vector<BenchResult> &results) {
+    for (size_t channels: {2, 4, 8}) {
+        for (size_t frames: {64, 256, 1024}) {
+            for (bool wrap: {false, true}) {
+                results.push_back(benchThroughput<PlainRing<T>, T>(channels, frames, wrap));
+                results.push_back(benchThroughput<PowerOfTwoRing<T>, T>(channels, frames, wrap));
+                results.push_back(benchThroughput<MirroredBroadcastRing<T>, T>(channels, frames, wrap));
+            }
+        }
+    }
+}
+
+static void printCsv(const std::vector<BenchResult> &results) {
+    printf("bench,ring,type,channels,frames,layout,blocks,ns_per_block,mframes_per_s,p50_ns,p99_ns,max_ns\n");
+    for (const auto &r: results) {
+        printf("%s,%s,%s,%zu,%zu,%s,%zu,",
+               r.bench.c_str(), r.ring.c_str(), r.type.c_str(), r.channels, r.frames, r.layout.c_str(), r.blocks);
+        // Columns that don't apply to a case are left empty.
+        if (r.bench == "latency") {
+            printf(",,%.0f,%.0f,%.0f\n", r.p50Ns, r.p99Ns, r.maxNs);
+        } else {
+            printf("%.1f,%.2f,,,\n", r.nsPerBlock, r.mframesPerSec);
+        }
+    }
+}
+
+static void printJson(const std::vector<BenchResult> &results) {
+    printf("[\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &r = results[i];
+        printf("  {\"bench\": \"%s\", \"ring\": \"%s\", \"type\": \"%s\", \"channels\": %zu, \"frames\": %zu, "
+               "\"layout\": \"%s\", \"blocks\": %zu, ",
+               r.bench.c_str(), r.ring.c_str(), r.type.c_str(), r.channels, r.frames, r.layout.c_str(), r.blocks);
+        if (r.bench == "latency") {
+            printf("\"p50_ns\": %.0f, \"p99_ns\": %.0f, \"max_ns\": %.0f}", r.p50Ns, r.p99Ns, r.maxNs);
+        } else {
+            printf("\"ns_per_block\": %.1f, \"mframes_per_s\": %.2f}", r.nsPerBlock, r.mframesPerSec);
+        }
+        printf(i + 1 < results.size() ? ",\n" : "\n");
+    }
+    printf("]\n");
+}
+
+int main(int argc, char **argv) {
+    bool json = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) json = true;
+        else if (strcmp(argv[i], "--quick") == 0) g_quick = true;
+        else {
+            fprintf(stderr, "Usage: %s [--json] [--quick]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<BenchResult> results;
+    benchType<int32_t>(results);
+    benchType<float>(results);
+    for (size_t frames: {64, 256, 1024}) {
+        results.push_back(benchHandoffLatency(2, frames));
+    }
+
+    if (json) printJson(results);
+    else printCsv(results);
+    return 0;
+}
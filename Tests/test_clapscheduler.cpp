@@ -0,0 +1,167 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+// ClapScheduler runs on a virtual clock here: block and key event times are
+// made up, so every onset is known to the sample.
+
+#include "catch.hpp"
+#include "../Source/utils/ClapScheduler.h"
+#include "../Source/utils/KeyEvent.h"
+#include "../Source/utils/ClapVoicePool.h"
+#include "../Source/utils/ClapTable.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+static const int kRate = 48000;
+static const size_t kFrames = 480;  // 10ms blocks
+static const double kBlockTime = (double) kFrames / kRate;
+static const double kLatency = 0.03;
+static const int64_t kLatencySamples = 1440;
+static const double kStart = 1000.25;  // accurateTime() of the first block
+
+namespace {
+    struct VirtualKeyEvent {
+        KeyEvent event;
+        int64_t expectedOnset;
+    };
+
+    /**
+     * Runs the render loop: block b is rendered at blockTimes[b], and takes
+     * the key events seen since the previous block, like RunningState.
+     * Claps are rendered into one long mono timeline.
+     */
+    struct VirtualRenderLoop {
+        ClapScheduler scheduler{kRate, kLatency};
+        ClapVoicePool voices{64};
+        ClapTable<int32_t> table;
+        std::vector<int64_t> onsets;
+        std::vector<int32_t> timeline;
+
+        VirtualRenderLoop() {
+            // A click, then a quieter tail, so overlapping claps don't look like onsets.
+            table.bake({1.0, 0.25, 0.125}, 1.0);
+        }
+
+        void run(const std::vector<double> &blockTimes, const std::vector<KeyEvent> &events) {
+            size_t next = 0;
+            for (double blockTime: blockTimes) {
+                auto blockStart = scheduler.beginBlock(blockTime, kFrames);
+                for (; next < events.size() && events[next].time <= blockTime; next++) {
+                    auto onset = scheduler.onsetSample(events[next].time);
+                    onsets.push_back(onset);
+                    voices.trigger(events[next].keyUp ? 1 : 0, onset);
+                }
+                std::vector<int32_t> block(kFrames);
+                voices.render([&](const ClapVoice &voice) {
+                    return table.mix(blockStart - voice.startSample, block.data(), kFrames);
+                });
+                timeline.insert(timeline.end(), block.begin(), block.end());
+            }
+        }
+
+        /// Samples where a click starts.
+        [[nodiscard]] std::vector<int64_t> clicks() const {
+            std::vector<int64_t> found;
+            for (size_t i = 0; i < timeline.size(); i++) {
+                if (timeline[i] >= (1 << 24)) found.push_back((int64_t) i);
+            }
+            return found;
+        }
+    };
+}
+
+static std::vector<double> steadyBlockTimes(size_t count, double offset) {
+    std::vector<double> times(count);
+    for (size_t b = 0; b < count; b++) times[b] = kStart + offset + (double) b * kBlockTime;
+    return times;
+}
+
+TEST_CASE("Claps start a fixed latency after the key press, to the sample", "[clap_scheduler]") {
+    VirtualRenderLoop loop;
+
+    // Key presses at known samples after the first block, a tenth of a sample in.
+    const int64_t pressSamples[] = {17, 500, 503, 959, 960, 4321, 9999};
+    std::vector<KeyEvent> events;
+    std::vector<int64_t> expected;
+    for (auto s: pressSamples) {
+        KeyEvent event;
+        event.time = kStart + ((double) s + 0.1) / kRate;
+        event.keyUp = (s % 2) != 0;
+        events.push_back(event);
+        expected.push_back(s + kLatencySamples);
+    }
+
+    loop.run(steadyBlockTimes(30, 0), events);
+    REQUIRE(loop.onsets == expected);
+    REQUIRE(loop.clicks() == expected);
+    REQUIRE(loop.scheduler.resyncCount() == 0);
+}
+
+TEST_CASE("Clap spacing doesn't follow render loop jitter", "[clap_scheduler]") {
+    // The loop renders each block up to 2ms late, and sees key events only then.
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> jitter(0, 0.002);
+    auto blockTimes = steadyBlockTimes(600, 0);
+    for (auto &t: blockTimes) t += jitter(rng);
+
+    std::vector<KeyEvent> events;
+    for (int i = 0; i < 50; i++) {
+        KeyEvent event;
+        event.time = kStart + 0.5 + i * 0.0937;  // about 11 presses per second
+        events.push_back(event);
+    }
+
+    VirtualRenderLoop loop;
+    loop.run(blockTimes, events);
+    REQUIRE(loop.onsets.size() == events.size());
+    REQUIRE(loop.clicks() == loop.onsets);
+
+    // Quantized to the loop, spacing would be off by up to a block (480 samples).
+    int64_t worst = 0;
+    for (size_t i = 1; i < events.size(); i++) {
+        auto expected = std::llround((events[i].time - events[i - 1].time) * kRate);
+        worst = std::max<int64_t>(worst, std::abs(loop.onsets[i] - loop.onsets[i - 1] - expected));
+    }
+    INFO("worst spacing error " << worst << " samples");
+    REQUIRE(worst <= 8);
+}
+
+TEST_CASE("Clap scheduler anchors again after a stall", "[clap_scheduler]") {
+    ClapScheduler scheduler(kRate, kLatency);
+    for (int b = 0; b < 10; b++) scheduler.beginBlock(kStart + b * kBlockTime, kFrames);
+
+    // The loop stops for 200ms; the output stream just continues.
+    double resumed = kStart + 10 * kBlockTime + 0.2;
+    REQUIRE(scheduler.beginBlock(resumed, kFrames) == 10 * (int64_t) kFrames);
+    REQUIRE(scheduler.resyncCount() == 1);
+
+    auto onset = scheduler.onsetSample(resumed + 100.1 / kRate);
+    REQUIRE(onset == 10 * (int64_t) kFrames + 100 + kLatencySamples);
+}
+
+TEST_CASE("Late key events start at the current block", "[clap_scheduler]") {
+    ClapScheduler scheduler(kRate, 0.001);
+    for (int b = 0; b < 5; b++) scheduler.beginBlock(kStart + b * kBlockTime, kFrames);
+
+    // Seen 5ms late, with only 1ms of latency.
+    REQUIRE(scheduler.onsetSample(kStart + 4 * kBlockTime - 0.005) == scheduler.blockStart());
+    REQUIRE(scheduler.onsetSample(kStart + 4 * kBlockTime + 0.0001) > scheduler.blockStart());
+}
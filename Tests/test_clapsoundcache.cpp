@@ -0,0 +1,156 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "catch.hpp"
+#include "../Source/utils/ClapSoundCache.h"
+#include "../Source/utils/MappedFile.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    /// Empty directory under the system temp directory, removed at the end of the test.
+    struct TempDir {
+        fs::path path;
+
+        TempDir() {
+            auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+            path = fs::temp_directory_path() / ("trgkasio_test_" + std::to_string(stamp));
+            fs::create_directories(path);
+        }
+
+        ~TempDir() {
+            std::error_code ec;
+            fs::remove_all(path, ec);
+        }
+    };
+}
+
+static void writeFile(const fs::path &path, const std::vector<uint8_t> &content) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(content.data()), (std::streamsize) content.size());
+}
+
+static WaveSound randomSound(size_t length, int sampleRate, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    WaveSound sound;
+    sound.sampleRate = sampleRate;
+    sound.audio.resize(length);
+    for (auto &s: sound.audio) s = dist(rng);
+    return sound;
+}
+
+TEST_CASE("Mapped files show the file contents", "[clap_cache]") {
+    TempDir dir;
+    std::vector<uint8_t> content(10000);
+    for (size_t i = 0; i < content.size(); i++) content[i] = (uint8_t) (i * 7);
+    writeFile(dir.path / "a.wav", content);
+    writeFile(dir.path / "empty.wav", {});
+
+    auto file = MappedFile::open(dir.path / "a.wav");
+    REQUIRE(file);
+    REQUIRE(file->size() == content.size());
+    REQUIRE(memcmp(file->data(), content.data(), content.size()) == 0);
+
+    auto empty = MappedFile::open(dir.path / "empty.wav");
+    REQUIRE(empty);
+    REQUIRE(empty->size() == 0);
+
+    REQUIRE_FALSE(MappedFile::open(dir.path / "missing.wav"));
+    REQUIRE_FALSE(MappedFile::open(dir.path));
+}
+
+TEST_CASE("Clap content hash is FNV-1a", "[clap_cache]") {
+    const uint8_t a[] = {'a'};
+    REQUIRE(clapContentHash(nullptr, 0) == 0xcbf29ce484222325ull);
+    REQUIRE(clapContentHash(a, 1) == 0xaf63dc4c8601ec8cull);
+}
+
+TEST_CASE("Clap sound cache stores entries per content and sample rate", "[clap_cache]") {
+    TempDir dir;
+    ClapSoundCache cache(dir.path / "cache");  // created on first write
+    auto sound = randomSound(3000, 48000, 1);
+    WaveSound loaded;
+
+    REQUIRE_FALSE(cache.read(1234, 48000, &loaded));
+    REQUIRE(cache.write(1234, 48000, sound));
+    REQUIRE(fs::exists(cache.pathFor(1234, 48000)));
+
+    REQUIRE(cache.read(1234, 48000, &loaded));
+    REQUIRE(loaded.sampleRate == 48000);
+    REQUIRE(loaded.audio == sound.audio);
+
+    // Other rates and other content are other entries.
+    REQUIRE_FALSE(cache.read(1234, 44100, &loaded));
+    REQUIRE_FALSE(cache.read(1235, 48000, &loaded));
+
+    auto other = randomSound(2000, 44100, 2);
+    REQUIRE(cache.write(1234, 44100, other));
+    REQUIRE(cache.read(1234, 44100, &loaded));
+    REQUIRE(loaded.audio == other.audio);
+    REQUIRE(cache.read(1234, 48000, &loaded));
+    REQUIRE(loaded.audio == sound.audio);
+
+    // Rewriting replaces the entry.
+    REQUIRE(cache.write(1234, 48000, other));
+    REQUIRE(cache.read(1234, 48000, &loaded));
+    REQUIRE(loaded.audio == other.audio);
+}
+
+TEST_CASE("Damaged clap sound cache entries are misses", "[clap_cache]") {
+    TempDir dir;
+    ClapSoundCache cache(dir.path);
+    auto sound = randomSound(100, 48000, 3);
+    REQUIRE(cache.write(42, 48000, sound));
+    auto path = cache.pathFor(42, 48000);
+
+    std::vector<uint8_t> entry(fs::file_size(path));
+    std::ifstream(path, std::ios::binary).read(reinterpret_cast<char *>(entry.data()), (std::streamsize) entry.size());
+    WaveSound loaded;
+
+    SECTION("truncated") {
+        entry.resize(entry.size() - 4);
+        writeFile(path, entry);
+        REQUIRE_FALSE(cache.read(42, 48000, &loaded));
+    }
+    SECTION("bad magic") {
+        entry[0] ^= 1;
+        writeFile(path, entry);
+        REQUIRE_FALSE(cache.read(42, 48000, &loaded));
+    }
+    SECTION("renamed from another key") {
+        fs::rename(path, cache.pathFor(43, 48000));
+        REQUIRE_FALSE(cache.read(43, 48000, &loaded));
+    }
+    SECTION("empty") {
+        writeFile(path, {});
+        REQUIRE_FALSE(cache.read(42, 48000, &loaded));
+    }
+
+    // A damaged entry is simply written again.
+    REQUIRE(cache.write(42, 48000, sound));
+    REQUIRE(cache.read(42, 48000, &loaded));
+    REQUIRE(loaded.audio == sound.audio);
+}
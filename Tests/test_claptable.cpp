@@ -0,0 +1,95 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "catch.hpp"
+#include "../Source/utils/ClapTable.h"
+#include <cmath>
+#include <random>
+#include <vector>
+
+static std::vector<float> randomSound(size_t length, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> sound(length);
+    for (auto &s: sound) s = dist(rng);
+    return sound;
+}
+
+TEST_CASE("Clap tables are baked at mix bus level", "[clap_table]") {
+    auto sound = randomSound(500, 1);
+    ClapTable<int32_t> table;
+    ClapTable<float> tableFloat;
+    table.bake(sound, 0.5);
+    tableFloat.bake(sound, 0.5);
+    REQUIRE(table.size() == sound.size());
+    REQUIRE(tableFloat.size() == sound.size());
+
+    bool same = true;
+    for (size_t i = 0; i < sound.size(); i++) {
+        if (table.data()[i] != (int32_t) round(sound[i] * 0.5 * (1 << 24))) same = false;
+        if (tableFloat.data()[i] != sound[i] * 1.0f) same = false;
+    }
+    REQUIRE(same);
+}
+
+TEST_CASE("Clap tables rebake only when the gain changes", "[clap_table]") {
+    auto sound = randomSound(100, 2);
+    ClapTable<int32_t> table;
+    table.bake(sound, 0.5);
+    auto first = table.data()[10];
+
+    // Same gain: the table is kept even if the source changed.
+    auto louder = sound;
+    for (auto &s: louder) s *= 2;
+    table.bake(louder, 0.5);
+    REQUIRE(table.data()[10] == first);
+
+    table.bake(sound, 0.25);
+    REQUIRE(table.data()[10] == (int32_t) round(sound[10] * 0.25 * (1 << 24)));
+}
+
+TEST_CASE("Clap tables mix the part overlapping the block", "[clap_table]") {
+    const size_t frames = 64;
+    auto sound = randomSound(150, 3);
+    ClapTable<int32_t> table;
+    table.bake(sound, 1.0);
+
+    // Starts within the block, plays through, and ends within the third block.
+    const int64_t starts[] = {-10, 54, 118, 182};
+    const bool playing[] = {true, true, false, false};
+    for (size_t b = 0; b < 4; b++) {
+        INFO("block " << b);
+        std::vector<int32_t> out(frames, 7);
+        REQUIRE(table.mix(starts[b], out.data(), frames) == playing[b]);
+        bool same = true;
+        for (size_t i = 0; i < frames; i++) {
+            int64_t pos = starts[b] + (int64_t) i;
+            int32_t expected = 7 + (pos >= 0 && pos < (int64_t) sound.size() ? table.data()[pos] : 0);
+            if (out[i] != expected) same = false;
+        }
+        REQUIRE(same);
+    }
+
+    // A clap that hasn't started yet adds nothing.
+    std::vector<float> outFloat(frames, 0.25f);
+    ClapTable<float> tableFloat;
+    tableFloat.bake(sound, 1.0);
+    REQUIRE(tableFloat.mix(-100, outFloat.data(), frames));
+    REQUIRE(outFloat == std::vector<float>(frames, 0.25f));
+}
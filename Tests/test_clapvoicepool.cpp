@@ -0,0 +1,94 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "catch.hpp"
+#include "../Source/utils/ClapVoicePool.h"
+#include <algorithm>
+#include <vector>
+
+// Plays every voice for the `frames` samples from `blockStart`, retiring
+// voices whose sound of `soundLength` samples ends within the block.
+static std::vector<ClapVoice> renderBlock(ClapVoicePool &pool, int64_t blockStart, int64_t frames,
+                                          int64_t soundLength) {
+    std::vector<ClapVoice> played;
+    pool.render([&](const ClapVoice &voice) {
+        played.push_back(voice);
+        return voice.startSample + soundLength > blockStart + frames;
+    });
+    return played;
+}
+
+TEST_CASE("Clap voice pool visits nothing when idle", "[clap_voice]") {
+    ClapVoicePool pool(8);
+    REQUIRE(pool.capacity() == 8);
+    REQUIRE(pool.size() == 0);
+    REQUIRE(renderBlock(pool, 0, 100, 1000).empty());
+}
+
+TEST_CASE("Clap voices retire at the end of their sound", "[clap_voice]") {
+    ClapVoicePool pool(8);
+    pool.trigger(0, 0);
+    pool.trigger(1, 150);
+    REQUIRE(pool.size() == 2);
+
+    REQUIRE(renderBlock(pool, 0, 100, 200).size() == 2);
+    REQUIRE(pool.size() == 2);
+
+    // Voice 0 ends at 200, within [100, 200).
+    REQUIRE(renderBlock(pool, 100, 100, 200).size() == 2);
+    REQUIRE(pool.size() == 1);
+
+    auto played = renderBlock(pool, 200, 100, 200);
+    REQUIRE(played.size() == 1);
+    REQUIRE(played[0].sound == 1);
+    REQUIRE(played[0].startSample == 150);
+    REQUIRE(pool.size() == 1);
+
+    // Voice 1 ends at 350.
+    REQUIRE(renderBlock(pool, 300, 100, 200).size() == 1);
+    REQUIRE(pool.size() == 0);
+
+    REQUIRE(renderBlock(pool, 400, 100, 200).empty());
+}
+
+TEST_CASE("Full clap voice pool replaces the oldest voice", "[clap_voice]") {
+    ClapVoicePool pool(4);
+    pool.trigger(0, 300);
+    pool.trigger(0, 100);
+    pool.trigger(0, 400);
+    pool.trigger(0, 200);
+    REQUIRE(pool.size() == 4);
+
+    pool.trigger(1, 500);
+    REQUIRE(pool.size() == 4);
+
+    std::vector<int64_t> starts;
+    for (auto &voice: renderBlock(pool, 0, 100, 10000)) starts.push_back(voice.startSample);
+    std::sort(starts.begin(), starts.end());
+    REQUIRE(starts == std::vector<int64_t>{200, 300, 400, 500});
+}
+
+TEST_CASE("Clap voice pool clears", "[clap_voice]") {
+    ClapVoicePool pool(4);
+    pool.trigger(0, 0);
+    pool.trigger(1, 0);
+    pool.clear();
+    REQUIRE(pool.size() == 0);
+    REQUIRE(renderBlock(pool, 0, 100, 1000).empty());
+}
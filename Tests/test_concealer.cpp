@@ -0,0 +1,173 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "catch.hpp"
+#include "../Source/utils/UnderrunConcealer.h"
+#include "../Source/utils/BroadcastRingBuffer.h"
+#include "../Source/utils/DeviceWriter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+static const double pi = 3.14159265358979323846;
+static const size_t kChannels = 2;
+static const size_t kFade = 240;
+static const double kAmplitude = 1 << 30;
+static const double kPeriod = 100;  // frames
+
+// Interleaved sine with a different phase per channel.
+static int32_t sineAt(size_t frame, size_t ch) {
+    return (int32_t) std::lround(kAmplitude * std::sin(2 * pi * (double) frame / kPeriod + (double) ch));
+}
+
+namespace {
+    struct Step {
+        bool underrun;
+        size_t frames;
+    };
+}
+
+/**
+ * Plays `steps` through a concealer like LoadData does, and returns what
+ * reaches the device. Delivered blocks continue the sine where the last
+ * delivered block stopped, wrapped around the end of a small ring.
+ */
+static std::vector<int32_t> play(UnderrunConcealer &concealer, const std::vector<Step> &steps) {
+    std::vector<int32_t> output;
+    size_t sourceFrame = 0;
+    for (auto step: steps) {
+        RingSpans<const int32_t> spans;
+        std::vector<int32_t> first, second;
+        if (step.underrun) {
+            spans = concealer.conceal(step.frames);
+        } else {
+            size_t firstFrames = step.frames / 3;
+            for (size_t i = 0; i < step.frames; i++) {
+                auto &target = i < firstFrames ? first : second;
+                for (size_t ch = 0; ch < kChannels; ch++) target.push_back(sineAt(sourceFrame + i, ch));
+            }
+            sourceFrame += step.frames;
+            RingSpans<const int32_t> in{first.data(), firstFrames, second.data(), step.frames - firstFrames};
+            spans = concealer.deliver(in, step.frames);
+        }
+        REQUIRE(spans.size() >= step.frames);
+        size_t firstFrames = std::min(step.frames, spans.firstSize);
+        output.insert(output.end(), spans.first, spans.first + firstFrames * kChannels);
+        output.insert(output.end(), spans.second, spans.second + (step.frames - firstFrames) * kChannels);
+    }
+    return output;
+}
+
+static double maxStep(const std::vector<int32_t> &output) {
+    double worst = 0;
+    for (size_t i = kChannels; i < output.size(); i++) {
+        worst = std::max(worst, std::fabs((double) output[i] - (double) output[i - kChannels]));
+    }
+    return worst;
+}
+
+// Largest frame to frame change of the sine, plus a little for the fades.
+static const double kStepLimit = kAmplitude * 2 * pi / kPeriod + 3 * kAmplitude / kFade;
+
+TEST_CASE("Delivered blocks pass through untouched", "[concealer]") {
+    UnderrunConcealer concealer(kChannels, 512, kFade);
+    std::vector<int32_t> first(10 * kChannels, 1), second(20 * kChannels, 2);
+    RingSpans<const int32_t> in{first.data(), 10, second.data(), 20};
+    auto out = concealer.deliver(in, 30);
+    REQUIRE(out.first == in.first);
+    REQUIRE(out.second == in.second);
+    REQUIRE(concealer.concealedBlocks() == 0);
+}
+
+TEST_CASE("Underruns fade out and back in without jumps", "[concealer]") {
+    UnderrunConcealer concealer(kChannels, 512, kFade);
+    auto output = play(concealer, {{false, 512}, {false, 300}, {true, 512}, {false, 512}, {false, 512}});
+    REQUIRE(concealer.concealedBlocks() == 1);
+
+    // The concealment starts from the last delivered frame and ends in silence.
+    size_t underrunStart = 812 * kChannels;
+    for (size_t ch = 0; ch < kChannels; ch++) {
+        REQUIRE(output[underrunStart + ch] == output[underrunStart - kChannels + ch]);
+        REQUIRE(output[underrunStart + (511 * kChannels) + ch] == 0);
+    }
+    REQUIRE(maxStep(output) < kStepLimit);
+
+    // A silent underrun would have jumped by up to the amplitude.
+    REQUIRE(kStepLimit < kAmplitude / 4);
+
+    // Past the fade in, the delivered audio is back unchanged.
+    size_t resumed = (812 + 512 + kFade) * kChannels;
+    for (size_t i = resumed; i < output.size(); i++) {
+        size_t frame = i / kChannels - 512;
+        if (output[i] != sineAt(frame, i % kChannels)) FAIL("mismatch at sample " << i);
+    }
+}
+
+TEST_CASE("Fades longer than a block carry over between blocks", "[concealer]") {
+    UnderrunConcealer concealer(kChannels, 512, kFade);
+    // Short blocks, an underrun during the fade in, and one shorter than the fade. The first
+    // block fills the history, so the tails don't reach back to the silence before it.
+    std::vector<Step> steps = {{false, 300}, {false, 64}, {true, 64}, {true, 64}, {false, 64}, {false, 32},
+                               {true, 100}, {false, 64}, {false, 64}, {false, 64}, {false, 64},
+                               {false, 64}, {true, 1}, {false, 7}, {false, 512}};
+    auto output = play(concealer, steps);
+    REQUIRE(concealer.concealedBlocks() == 4);
+    REQUIRE(maxStep(output) < kStepLimit);
+
+    size_t tail = 512 - kFade;
+    for (size_t i = output.size() - tail * kChannels; i < output.size(); i++) {
+        size_t frame = i / kChannels - 64 - 64 - 100 - 1;
+        if (output[i] != sineAt(frame, i % kChannels)) FAIL("mismatch at sample " << i);
+    }
+}
+
+TEST_CASE("Concealment before any audio is silence", "[concealer]") {
+    UnderrunConcealer concealer(kChannels, 512, kFade);
+    auto out = concealer.conceal(512);
+    bool silent = true;
+    for (size_t i = 0; i < 512 * kChannels; i++) {
+        if (out.first[i] != 0) silent = false;
+    }
+    REQUIRE(silent);
+}
+
+TEST_CASE("Concealer fits between the output ring and the device writer", "[concealer]") {
+    // Same calls as LoadData, with the ring reader's const spans.
+    auto ring = std::make_shared<BroadcastRingBuffer<int32_t>>(kChannels, std::vector<RingReaderConfig>{{1024}});
+    BroadcastRingReader<int32_t> reader(ring, 0);
+    UnderrunConcealer concealer(kChannels, 256, kFade);
+    DeviceWriter writer(DeviceSampleFormat::Int32, kChannels);
+    std::vector<int32_t> out(256 * kChannels);
+
+    std::vector<std::vector<int32_t>> block(kChannels, std::vector<int32_t>(256, 1000));
+    REQUIRE(ring->pushPlanar(block));
+    auto spans = reader.readSpans();
+    spans = concealer.deliver(spans, 256);
+    writer.write(spans, 256, out.data());
+    reader.commitRead(256);
+    REQUIRE(out.back() == 1000);
+
+    spans = reader.readSpans();
+    REQUIRE(spans.size() == 0);
+    writer.write(concealer.conceal(256), 256, out.data());
+    reader.commitRead(0);
+    REQUIRE(out.front() == 1000);
+    REQUIRE(out.back() == 0);
+}
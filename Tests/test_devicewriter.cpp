@@ -0,0 +1,204 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "catch.hpp"
+#include "../Source/utils/DeviceWriter.h"
+#include "../Source/utils/BroadcastRingBuffer.h"
+#include <random>
+#include <vector>
+
+static const DeviceSampleFormat allFormats[] = {
+        DeviceSampleFormat::Int16,
+        DeviceSampleFormat::Int24In32,
+        DeviceSampleFormat::Int32,
+        DeviceSampleFormat::Float32,
+};
+
+// Plain per-sample conversion of the first `frames` frames of `spans`.
+static void referenceWrite(DeviceSampleFormat format, size_t channels, const RingSpans<const int32_t> &spans,
+                           size_t frames, uint8_t *out) {
+    for (size_t i = 0; i < frames * channels; i++) {
+        size_t firstSamples = spans.firstSize * channels;
+        int32_t s = i < firstSamples ? spans.first[i] : spans.second[i - firstSamples];
+        switch (format) {
+            case DeviceSampleFormat::Int16:
+                reinterpret_cast<int16_t *>(out)[i] = (int16_t) (s >> 16);
+                break;
+            case DeviceSampleFormat::Int24In32:
+                reinterpret_cast<int32_t *>(out)[i] = (int32_t) ((uint32_t) s & 0xFFFFFF00u);
+                break;
+            case DeviceSampleFormat::Int32:
+                reinterpret_cast<int32_t *>(out)[i] = s;
+                break;
+            case DeviceSampleFormat::Float32:
+                reinterpret_cast<float *>(out)[i] = (float) s / 2147483648.0f;
+                break;
+        }
+    }
+}
+
+TEST_CASE("Device writers convert wrapped spans to every format", "[device_writer]") {
+    std::mt19937 rng(5);
+    for (auto format: allFormats) {
+        for (size_t channels: {1, 2, 3, 4, 6, 8}) {
+            DeviceWriter writer(format, channels);
+            INFO("format " << (int) format << ", " << channels << " channels");
+            REQUIRE(writer.frameBytes() == channels * deviceSampleSize(format));
+
+            // Wrapped spans, like a heap ring buffer right after the wrap point.
+            std::vector<int32_t> first(37 * channels), second(64 * channels);
+            for (auto &s: first) s = (int32_t) rng();
+            for (auto &s: second) s = (int32_t) rng();
+            RingSpans<const int32_t> spans{first.data(), 37, second.data(), 64};
+
+            for (size_t frames: {0, 1, 20, 37, 38, 101}) {
+                size_t bytes = frames * writer.frameBytes();
+                std::vector<uint8_t> expected(bytes + 16, 0xAB), out(bytes + 16, 0xAB);
+                referenceWrite(format, channels, spans, frames, expected.data());
+                writer.write(spans, frames, out.data());
+                REQUIRE(out == expected);
+
+                writer.silence(frames, out.data());
+                bool silent = true;
+                for (size_t i = 0; i < bytes; i++) {
+                    if (out[i] != 0) silent = false;
+                }
+                REQUIRE(silent);
+                REQUIRE(out[bytes] == 0xAB);
+            }
+        }
+    }
+}
+
+TEST_CASE("16-bit device writers dither like the dither kernels", "[device_writer]") {
+    std::mt19937 rng(6);
+    for (auto dither: {DitherMode::Tpdf, DitherMode::Shaped}) {
+        for (size_t channels: {2, 3}) {
+            INFO("dither " << (int) dither << ", " << channels << " channels");
+            std::vector<int32_t> first(37 * channels), second(64 * channels);
+            for (auto &s: first) s = (int32_t) rng();
+            for (auto &s: second) s = (int32_t) rng();
+            RingSpans<const int32_t> spans{first.data(), 37, second.data(), 64};
+
+            DeviceWriter writer(DeviceSampleFormat::Int16, channels, dither, 11);
+            DitherState state(channels, 11);
+            auto convert = dither == DitherMode::Tpdf ? convertInt32ToInt16Dither
+                                                      : convertInt32ToInt16ShapedDither;
+            // Twice, so the second write continues the state of the first.
+            for (int round = 0; round < 2; round++) {
+                std::vector<int16_t> expected(101 * channels), out(101 * channels);
+                convert(first.data(), expected.data(), first.size(), &state);
+                convert(second.data(), expected.data() + first.size(), second.size(), &state);
+                writer.write(spans, 101, out.data());
+                REQUIRE(out == expected);
+            }
+        }
+    }
+}
+
+TEST_CASE("Device writers ramp to a new gain frame by frame", "[device_writer]") {
+    const size_t channels = 2, ramp = 100;
+    // Constant input, so every output frame shows its gain.
+    std::vector<int32_t> first(37 * channels, 1 << 30), second(64 * channels, 1 << 30);
+    RingSpans<const int32_t> spans{first.data(), 37, second.data(), 64};
+
+    DeviceWriter writer(DeviceSampleFormat::Int32, channels);
+    writer.setGainRampFrames(ramp);
+    std::vector<int32_t> out;
+    auto play = [&](float gain, int blocks) {
+        for (int b = 0; b < blocks; b++) {
+            std::vector<int32_t> block(101 * channels);
+            writer.write(spans, 101, block.data(), gain);
+            out.insert(out.end(), block.begin(), block.end());
+        }
+    };
+    play(1, 1);
+    play(0.5f, 2);  // ramp down, crossing blocks and the span boundary
+    play(0, 2);  // mute
+    play(1, 2);  // back to unity
+
+    auto gainAt = [&](size_t frame) { return out[frame * channels] / (double) (1 << 30); };
+    bool smooth = true;
+    for (size_t f = 0; f < out.size() / channels; f++) {
+        if (out[f * channels] != out[f * channels + 1]) smooth = false;  // same gain on every channel
+        if (f > 0 && std::fabs(gainAt(f) - gainAt(f - 1)) > 1.0 / ramp + 1e-6) smooth = false;
+    }
+    REQUIRE(smooth);
+
+    // A ramp starts at the old gain and reaches the new one `ramp` frames later.
+    REQUIRE(gainAt(101) == 1);
+    REQUIRE(gainAt(102) < 1);
+    REQUIRE(std::fabs(gainAt(151) - 0.75) < 0.01);
+    REQUIRE(gainAt(201) == 0.5);
+    REQUIRE(gainAt(303) == 0.5);
+    REQUIRE(gainAt(304) < 0.5);
+    REQUIRE(gainAt(403) == 0);
+    REQUIRE(gainAt(505) == 0);
+    REQUIRE(gainAt(506) > 0);
+    REQUIRE(gainAt(605) == 1);
+    REQUIRE(out.back() == 1 << 30);
+}
+
+TEST_CASE("Device writers at unity gain after a ramp match the plain conversion", "[device_writer]") {
+    std::mt19937 rng(8);
+    for (auto format: allFormats) {
+        INFO("format " << (int) format);
+        const size_t channels = 2;
+        std::vector<int32_t> first(37 * channels), second(64 * channels);
+        for (auto &s: first) s = (int32_t) rng();
+        for (auto &s: second) s = (int32_t) rng();
+        RingSpans<const int32_t> spans{first.data(), 37, second.data(), 64};
+
+        DeviceWriter writer(format, channels);
+        writer.setGainRampFrames(50);
+        size_t bytes = 101 * writer.frameBytes();
+        std::vector<uint8_t> out(bytes), expected(bytes);
+        referenceWrite(format, channels, spans, 101, expected.data());
+
+        // Down and back up: everything after the ramp is untouched, even in the same block.
+        writer.write(spans, 101, out.data(), 0.25f);
+        writer.write(spans, 101, out.data(), 1);
+        size_t rampBytes = 50 * writer.frameBytes();
+        REQUIRE(std::equal(out.begin() + (ptrdiff_t) rampBytes, out.end(),
+                           expected.begin() + (ptrdiff_t) rampBytes));
+        writer.write(spans, 101, out.data(), 1);
+        REQUIRE(out == expected);
+    }
+}
+
+TEST_CASE("Device writers take the output ring's read spans", "[device_writer]") {
+    // LoadData passes BroadcastRingReader::readSpans() straight to the writer.
+    const size_t channels = 2;
+    auto ring = std::make_shared<BroadcastRingBuffer<int32_t>>(channels, std::vector<RingReaderConfig>{{256}});
+    BroadcastRingReader<int32_t> reader(ring, 0);
+    std::vector<std::vector<int32_t>> block(channels, std::vector<int32_t>(100));
+    for (size_t ch = 0; ch < channels; ch++) {
+        for (size_t i = 0; i < 100; i++) block[ch][i] = (int32_t) (i * 1000 + ch);
+    }
+    REQUIRE(ring->pushPlanar(block));
+
+    DeviceWriter writer(DeviceSampleFormat::Int32, channels);
+    std::vector<int32_t> out(100 * channels);
+    auto spans = reader.readSpans();
+    writer.write(spans, 100, out.data());
+    reader.commitRead(100);
+    for (size_t i = 0; i < 100; i++) {
+        REQUIRE(out[i * channels] == block[0][i]);
+        REQUIRE(out[i * channels + 1] == block[1][i]);
+    }
+}
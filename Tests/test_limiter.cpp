@@ -0,0 +1,139 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "catch.hpp"
+#include "../Source/utils/LookaheadLimiter.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using PlanarFloat = std::vector<std::vector<float>>;
+
+static const double pi = 3.14159265358979323846;
+
+// Runs `input` through a limiter in blocks of `blockSize` frames.
+static PlanarFloat runLimiter(const PlanarFloat &input, size_t blockSize, double lookaheadMs = 1.0) {
+    size_t channels = input.size(), frames = input[0].size();
+    LookaheadLimiter limiter(channels, 48000, lookaheadMs, blockSize);
+    PlanarFloat output(channels, std::vector<float>(frames));
+    PlanarFloat block(channels, std::vector<float>(blockSize));
+    for (size_t pos = 0; pos < frames; pos += blockSize) {
+        size_t n = std::min(blockSize, frames - pos);
+        for (size_t ch = 0; ch < channels; ch++) {
+            block[ch].assign(input[ch].begin() + (ptrdiff_t) pos, input[ch].begin() + (ptrdiff_t) (pos + n));
+        }
+        limiter.process(&block);
+        for (size_t ch = 0; ch < channels; ch++) {
+            std::copy(block[ch].begin(), block[ch].end(), output[ch].begin() + (ptrdiff_t) pos);
+        }
+    }
+    return output;
+}
+
+static PlanarFloat sine(size_t channels, size_t frames, double amplitude, double cyclesPerFrame, double phase) {
+    PlanarFloat out(channels, std::vector<float>(frames));
+    for (size_t ch = 0; ch < channels; ch++) {
+        for (size_t i = 0; i < frames; i++) {
+            out[ch][i] = (float) (amplitude * std::sin(2 * pi * cyclesPerFrame * i + phase + ch));
+        }
+    }
+    return out;
+}
+
+static float maxAbs(const std::vector<float> &v, size_t from = 0) {
+    float m = 0;
+    for (size_t i = from; i < v.size(); i++) m = std::max(m, std::fabs(v[i]));
+    return m;
+}
+
+TEST_CASE("Limiter latency follows the lookahead", "[limiter]") {
+    REQUIRE(LookaheadLimiter::latencyFrames(48000, 1.0) == 48 - 1 + 4);
+    REQUIRE(LookaheadLimiter::latencyFrames(48000, 0.1) == LookaheadLimiter::latencyFrames(48000, 0.5));
+    REQUIRE(LookaheadLimiter::latencyFrames(48000, 10) == LookaheadLimiter::latencyFrames(48000, 2.0));
+    LookaheadLimiter limiter(2, 44100, 2.0, 256);
+    REQUIRE(limiter.latency() == 88 - 1 + 4);
+}
+
+TEST_CASE("Limiter passes quiet audio through, delayed", "[limiter]") {
+    auto in = sine(2, 4000, 0.8, 0.013, 0);
+    in[0][100] = LookaheadLimiter::kCeiling;  // exactly at the ceiling is fine too
+    auto out = runLimiter(in, 256);
+    size_t latency = LookaheadLimiter::latencyFrames(48000, 1.0);
+    bool same = true;
+    for (size_t ch = 0; ch < 2; ch++) {
+        for (size_t i = 0; i < latency; i++) {
+            if (out[ch][i] != 0) same = false;
+        }
+        for (size_t i = latency; i < in[0].size(); i++) {
+            if (out[ch][i] != in[ch][i - latency]) same = false;
+        }
+    }
+    REQUIRE(same);
+}
+
+TEST_CASE("Limiter keeps loud audio under the ceiling", "[limiter]") {
+    std::mt19937 rng(9);
+    std::uniform_real_distribution<float> noise(-3.0f, 3.0f);
+    auto in = sine(2, 20000, 2.5, 0.021, 0.3);
+    for (size_t i = 5000; i < 6000; i++) in[1][i] = noise(rng);  // bursts of loud noise
+    in[0][12000] = 40.0f;  // a single spike
+
+    for (double lookahead: {0.5, 1.0, 2.0}) {
+        auto out = runLimiter(in, 192, lookahead);
+        for (size_t ch = 0; ch < 2; ch++) {
+            REQUIRE(maxAbs(out[ch]) <= LookaheadLimiter::kCeiling);
+        }
+    }
+}
+
+TEST_CASE("Limiter catches inter-sample peaks", "[limiter]") {
+    // fs/4 at 45 degrees: every sample is at 0.707 of the real peak.
+    auto in = sine(1, 8000, 1.2, 0.25, pi / 4);
+    REQUIRE(maxAbs(in[0]) < LookaheadLimiter::kCeiling);
+    auto out = runLimiter(in, 256);
+    // The waveform peaks at 1.2 between samples, so the gain must come down to about ceiling / 1.2.
+    REQUIRE(maxAbs(out[0], 4000) < LookaheadLimiter::kCeiling * 0.75f);
+}
+
+TEST_CASE("Limiter output does not depend on the block size", "[limiter]") {
+    auto in = sine(3, 10000, 1.8, 0.007, 1.0);
+    auto expected = runLimiter(in, 10000);
+    for (size_t blockSize: {1, 7, 64, 512}) {
+        INFO("block size " << blockSize);
+        REQUIRE(runLimiter(in, blockSize) == expected);
+    }
+}
+
+static float limiterGainAfter(const PlanarFloat &input) {
+    LookaheadLimiter limiter(input.size(), 48000, 1.0, input[0].size());
+    auto block = input;
+    limiter.process(&block);
+    return limiter.currentGain();
+}
+
+TEST_CASE("Limiter releases after a peak", "[limiter]") {
+    auto in = sine(1, 48000, 0.5, 0.01, 0);
+    for (size_t i = 1000; i < 1100; i++) in[0][i] *= 4;
+    auto out = runLimiter(in, 256);
+    REQUIRE(maxAbs(out[0]) <= LookaheadLimiter::kCeiling);
+    // Release is 50ms; half a second later the gain is back to unity.
+    size_t latency = LookaheadLimiter::latencyFrames(48000, 1.0);
+    REQUIRE(out[0][30010 + latency] == in[0][30010]);
+    REQUIRE(limiterGainAfter(in) == 1.0f);
+}
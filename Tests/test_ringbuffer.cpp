@@ -19,6 +19,11 @@
 
 #include "catch.hpp"
 #include "../Source/utils/RingBuffer.h"
+#include "../Source/utils/BroadcastRingBuffer.h"
+#include "../Source/utils/RingFillStats.h"
+#include <thread>
+#include <vector>
+#include <cstring>
 
 TEST_CASE("Ringbuffer push", "[ring_buffer]") {
     RingBuffer<int> rb(10);
@@ -88,3 +93,464 @@ TEST_CASE("Ringbuffer works", "[ring_buffer]") {
         REQUIRE(memcmp(arr, expected, sizeof(int) * 9) == 0);
     }
 }
+
+
+TEST_CASE("Ringbuffer stores interleaved frames", "[ring_buffer]") {
+    RingBuffer<int> rb(5, 2);
+    REQUIRE(rb.capacity() == 5);
+    REQUIRE(rb.frameSize() == 2);
+
+    {
+        int arr[6] = {1, -1, 2, -2, 3, -3};
+        REQUIRE(rb.push(arr, 3));
+        REQUIRE(rb.size() == 3);
+    }
+
+    {
+        int arr[4];
+        int expected[4] = {1, -1, 2, -2};
+        REQUIRE(rb.get(arr, 2));
+        REQUIRE(memcmp(arr, expected, sizeof(expected)) == 0);
+        REQUIRE(rb.size() == 1);
+    }
+
+    // wrapping planar push interleaves channels
+    {
+        std::vector<std::vector<int>> planar = {{4, 5, 6}, {-4, -5, -6}};
+        REQUIRE(rb.pushPlanar(planar));
+        REQUIRE(rb.size() == 4);
+        REQUIRE(!rb.pushPlanar(planar));
+    }
+
+    // wrapping get
+    {
+        int arr[8];
+        int expected[8] = {3, -3, 4, -4, 5, -5, 6, -6};
+        REQUIRE(rb.get(arr, 4));
+        REQUIRE(memcmp(arr, expected, sizeof(expected)) == 0);
+        REQUIRE(rb.size() == 0);
+    }
+}
+
+TEST_CASE("Ringbuffer span access", "[ring_buffer]") {
+    RingBuffer<int> rb(6, 2);
+
+    // Write 4 frames in place, then consume 3 of them in place
+    {
+        auto spans = rb.writeSpans();
+        REQUIRE(spans.size() == 5);
+        REQUIRE(spans.secondSize == 0);
+        for (int i = 0; i < 8; i++) spans.first[i] = i;
+        rb.commitWrite(4);
+        REQUIRE(rb.size() == 4);
+
+        auto readSpans = rb.readSpans();
+        REQUIRE(readSpans.size() == 4);
+        REQUIRE(readSpans.first[6] == 6);
+        rb.commitRead(3);
+        REQUIRE(rb.size() == 1);
+    }
+
+    // Free region now wraps around the end of the storage
+    {
+        auto spans = rb.writeSpans();
+        REQUIRE(spans.firstSize == 2);
+        REQUIRE(spans.secondSize == 2);
+        int frames[8] = {8, 9, 10, 11, 12, 13, 14, 15};
+        REQUIRE(rb.push(frames, 4));
+    }
+
+    {
+        auto spans = rb.readSpans();
+        REQUIRE(spans.firstSize == 3);
+        REQUIRE(spans.secondSize == 2);
+        int expected[10] = {6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+        REQUIRE(memcmp(spans.first, expected, sizeof(int) * 6) == 0);
+        REQUIRE(memcmp(spans.second, expected + 6, sizeof(int) * 4) == 0);
+        rb.commitRead(spans.size());
+        REQUIRE(rb.size() == 0);
+    }
+}
+
+TEST_CASE("Mirrored memory maps the same pages twice", "[ring_buffer]") {
+    auto size = MirroredMemory::granularity();
+    auto memory = MirroredMemory::create(size);
+    REQUIRE(memory);
+
+    auto p = static_cast<volatile char *>(memory->data());
+    p[0] = 'a';
+    p[size - 1] = 'z';
+    REQUIRE(p[size] == 'a');
+    REQUIRE(p[2 * size - 1] == 'z');
+    p[size + 1] = 'b';
+    REQUIRE(p[1] == 'b');
+
+    REQUIRE(!MirroredMemory::create(size + 1));
+}
+
+TEST_CASE("Mirrored ringbuffer never splits spans", "[ring_buffer]") {
+    RingBuffer<int> rb(10, 3, RingBufferStorage::Mirrored);
+    REQUIRE(rb.isMirrored());
+    REQUIRE(rb.capacity() == 10);
+
+    // capacity still bounds the fill level
+    {
+        int arr[30] = {0};
+        REQUIRE(!rb.push(arr, 10));
+        REQUIRE(rb.push(arr, 9));
+        REQUIRE(rb.get(arr, 9));
+    }
+
+    // Walk the positions all the way around the storage
+    int next = 0;
+    int expected = 0;
+    for (int round = 0; round < 5000; round++) {
+        auto writeSpans = rb.writeSpans();
+        REQUIRE(writeSpans.secondSize == 0);
+        auto frames = 1 + round % 9;
+        for (int i = 0; i < frames * 3; i++) writeSpans.first[i] = next++;
+        rb.commitWrite(frames);
+
+        auto readSpans = rb.readSpans();
+        REQUIRE(readSpans.secondSize == 0);
+        REQUIRE(readSpans.size() == (size_t) frames);
+        for (int i = 0; i < frames * 3; i++) {
+            REQUIRE(readSpans.first[i] == expected++);
+        }
+        rb.commitRead(frames);
+    }
+}
+
+TEST_CASE("Power-of-two ringbuffer", "[ring_buffer]") {
+    PowerOfTwoRingBuffer<int> rb(10, 2);
+    REQUIRE(rb.capacity() == 16);
+
+    int frames[32];
+    for (int i = 0; i < 32; i++) frames[i] = i;
+    REQUIRE(!rb.push(frames, 16));
+    REQUIRE(rb.push(frames, 15));
+    int next = 30;
+    REQUIRE(rb.size() == 15);
+
+    // Positions keep running past the storage size
+    int expected = 0;
+    for (int round = 0; round < 100; round++) {
+        int out[14];
+        REQUIRE(rb.get(out, 7));
+        for (int v: out) REQUIRE(v == expected++);
+
+        for (int i = 0; i < 14; i++) frames[i] = next++;
+        REQUIRE(rb.push(frames, 7));
+        REQUIRE(rb.size() == 15);
+        REQUIRE(rb.rp() < 16);
+        REQUIRE(rb.wp() < 16);
+    }
+}
+
+TEST_CASE("Ringbuffer producer/consumer on separate threads", "[ring_buffer]") {
+    const int totalCount = 1000000;
+    RingBuffer<int> rb(97);
+
+    std::thread producer([&rb]() {
+        int chunk[13];
+        int next = 0;
+        while (next < totalCount) {
+            int chunkSize = std::min(1 + next % 13, totalCount - next);
+            for (int i = 0; i < chunkSize; i++) chunk[i] = next + i;
+            while (!rb.push(chunk, chunkSize)) std::this_thread::yield();
+            next += chunkSize;
+        }
+    });
+
+    int chunk[11];
+    int expected = 0;
+    bool inOrder = true;
+    while (expected < totalCount) {
+        int chunkSize = std::min(1 + expected % 11, totalCount - expected);
+        while (!rb.get(chunk, chunkSize)) std::this_thread::yield();
+        for (int i = 0; i < chunkSize; i++) {
+            if (chunk[i] != expected + i) inOrder = false;
+        }
+        expected += chunkSize;
+    }
+    producer.join();
+
+    REQUIRE(inOrder);
+    REQUIRE(rb.size() == 0);
+}
+
+
+TEST_CASE("Broadcast ringbuffer readers are independent", "[ring_buffer]") {
+    auto ring = std::make_shared<BroadcastRingBuffer<int>>(6, 2, 2);
+    REQUIRE(ring->capacity() == 8);
+    BroadcastRingReader<int> reader0(ring, 0), reader1(ring, 1);
+
+    int frames[14];
+    for (int i = 0; i < 14; i++) frames[i] = i;
+    REQUIRE(ring->push(frames, 5));
+    REQUIRE(reader0.size() == 5);
+    REQUIRE(reader1.size() == 5);
+
+    // Reader 0 drains; reader 1 still holds the writer back
+    int out[14];
+    REQUIRE(reader0.get(out, 5));
+    REQUIRE(memcmp(out, frames, sizeof(int) * 10) == 0);
+    REQUIRE(reader0.size() == 0);
+    REQUIRE(reader1.size() == 5);
+    REQUIRE(ring->maxSize() == 5);
+    REQUIRE(!ring->push(frames, 3));
+    REQUIRE(ring->push(frames, 2));
+
+    REQUIRE(reader1.get(out, 7));
+    int expected[14] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3};
+    REQUIRE(memcmp(out, expected, sizeof(expected)) == 0);
+    REQUIRE(reader0.get(out, 2));
+    REQUIRE(memcmp(out, frames, sizeof(int) * 4) == 0);
+    REQUIRE(ring->maxSize() == 0);
+}
+
+TEST_CASE("Broadcast ringbuffer with readers on separate threads", "[ring_buffer]") {
+    const int totalCount = 300000;
+    const int readerCount = 3;
+    BroadcastRingBuffer<int> ring(61, 1, readerCount, RingBufferStorage::Mirrored);
+
+    std::vector<std::thread> readers;
+    std::vector<char> inOrder(readerCount, 0);
+    for (int r = 0; r < readerCount; r++) {
+        readers.emplace_back([&ring, &inOrder, r]() {
+            int chunk[16];
+            int expected = 0;
+            bool ok = true;
+            while (expected < totalCount) {
+                int chunkSize = std::min(1 + (expected + r) % 16, totalCount - expected);
+                while (!ring.get(r, chunk, chunkSize)) std::this_thread::yield();
+                for (int i = 0; i < chunkSize; i++) {
+                    if (chunk[i] != expected + i) ok = false;
+                }
+                expected += chunkSize;
+            }
+            inOrder[r] = ok;
+        });
+    }
+
+    int chunk[13];
+    int next = 0;
+    while (next < totalCount) {
+        int chunkSize = std::min(1 + next % 13, totalCount - next);
+        for (int i = 0; i < chunkSize; i++) chunk[i] = next + i;
+        while (!ring.push(chunk, chunkSize)) std::this_thread::yield();
+        next += chunkSize;
+    }
+    for (auto &t: readers) t.join();
+
+    for (int r = 0; r < readerCount; r++) REQUIRE(inOrder[r]);
+    REQUIRE(ring.maxSize() == 0);
+}
+
+TEST_CASE("Broadcast ringbuffer overflow policies", "[ring_buffer]") {
+    BroadcastRingBuffer<int> ring(1, {
+            {8,  RingOverflowPolicy::DropNewest},
+            {6,  RingOverflowPolicy::DropOldest},
+            {6,  RingOverflowPolicy::Trim, 1},
+    });
+    REQUIRE(ring.capacity() == 8);
+
+    int frames[4] = {0, 1, 2, 3};
+    REQUIRE(ring.push(frames, 4));
+
+    // Over the limit of readers 1 and 2, which drop their oldest frames
+    int more[2] = {4, 5};
+    REQUIRE(ring.push(more, 2));
+    REQUIRE(ring.size(0) == 6);
+    REQUIRE(ring.size(1) == 5);
+    REQUIRE(ring.size(2) == 3);
+
+    // Dropped frames are counted once the reader skips over them
+    REQUIRE(ring.droppedFrames(1) == 0);
+    int out[8];
+    REQUIRE(ring.get(1, out, 5));
+    REQUIRE(ring.droppedFrames(1) == 1);
+    REQUIRE(out[0] == 1);
+    REQUIRE(out[4] == 5);
+    REQUIRE(ring.get(2, out, 3));
+    REQUIRE(ring.droppedFrames(2) == 3);
+    REQUIRE(out[0] == 3);
+
+    // Reader 0 keeps its queue, so the block is rejected for everyone
+    REQUIRE(!ring.push(more, 2));
+    REQUIRE(ring.size(1) == 0);
+    REQUIRE(ring.get(0, out, 6));
+    REQUIRE(ring.push(more, 2));
+}
+
+TEST_CASE("Broadcast ringbuffer keeps frames that are being read", "[ring_buffer]") {
+    BroadcastRingBuffer<int> ring(1, {{4, RingOverflowPolicy::DropOldest}});
+    int frames[3] = {0, 1, 2};
+    REQUIRE(ring.push(frames, 3));
+
+    auto spans = ring.readSpans(0);
+    REQUIRE(spans.size() == 3);
+
+    // The frames it is reading must stay, and the rejected block drops nothing
+    REQUIRE(!ring.push(frames, 3));
+    REQUIRE(spans.first[0] == 0);
+    ring.commitRead(0, 1);
+    REQUIRE(ring.size(0) == 2);
+
+    REQUIRE(ring.push(frames, 3));
+    REQUIRE(ring.size(0) == 3);
+}
+
+TEST_CASE("Broadcast ringbuffer rejects a block before dropping anyone's frames", "[ring_buffer]") {
+    BroadcastRingBuffer<int> ring(1, {
+            {8, RingOverflowPolicy::DropOldest},
+            {8, RingOverflowPolicy::DropOldest},
+    });
+    int frames[6] = {0, 1, 2, 3, 4, 5};
+    REQUIRE(ring.push(frames, 6));
+
+    // Reader 1 pins frame 0, so the block is rejected. Reader 0 comes first
+    // and would need to drop 3 frames for it, but must keep them.
+    auto pinned = ring.readSpans(1);
+    REQUIRE(pinned.size() == 6);
+    REQUIRE(!ring.push(frames, 4));
+    REQUIRE(ring.size(0) == 6);
+    REQUIRE(ring.size(1) == 6);
+
+    int out[8];
+    REQUIRE(ring.get(0, out, 6));
+    REQUIRE(ring.droppedFrames(0) == 0);
+    REQUIRE(out[0] == 0);
+    REQUIRE(out[5] == 5);
+
+    ring.commitRead(1, 6);
+    REQUIRE(ring.push(frames, 4));
+    REQUIRE(ring.size(0) == 4);
+    REQUIRE(ring.size(1) == 4);
+}
+
+TEST_CASE("Broadcast ringbuffer detaches a stalled DropNewest reader", "[ring_buffer]") {
+    BroadcastRingBuffer<int> ring(1, {
+            {8, RingOverflowPolicy::DropNewest, 0, 3},
+            {8, RingOverflowPolicy::DropNewest},
+    });
+    int frames[4] = {0, 1, 2, 3};
+    int out[8];
+    REQUIRE(ring.push(frames, 4));
+    REQUIRE(ring.get(1, out, 4));
+
+    // Reader 0 holds back two blocks, then gets detached on the third
+    REQUIRE(!ring.push(frames, 4));
+    REQUIRE(!ring.push(frames, 4));
+    REQUIRE(!ring.isDetached(0));
+    REQUIRE(ring.push(frames, 4));
+    REQUIRE(ring.isDetached(0));
+    REQUIRE(ring.size(0) == 7);
+    REQUIRE(ring.size(1) == 4);
+    REQUIRE(ring.get(1, out, 4));
+    REQUIRE(ring.push(frames, 4));
+    REQUIRE(ring.size(0) == 7);
+
+    // Reading reattaches it, and it holds back the writer again when full
+    REQUIRE(ring.get(0, out, 1));
+    REQUIRE(ring.droppedFrames(0) == 5);
+    REQUIRE(!ring.isDetached(0));
+    REQUIRE(ring.get(1, out, 4));
+    REQUIRE(ring.size(0) == 6);
+    REQUIRE(ring.push(frames, 1));
+    REQUIRE(ring.size(0) == 7);
+    REQUIRE(!ring.push(frames, 1));
+    REQUIRE(!ring.isDetached(0));
+}
+
+TEST_CASE("Broadcast ringbuffer drops oldest frames of a slow reader on another thread", "[ring_buffer]") {
+    const int totalCount = 50000;
+    BroadcastRingBuffer<int> ring(1, {
+            {64, RingOverflowPolicy::DropNewest},
+            {32, RingOverflowPolicy::DropOldest},
+    });
+
+    std::atomic<bool> done{false};
+    bool slowInOrder = true, fastInOrder = true;
+    size_t slowReadCount = 0;
+    std::thread slowReader([&]() {
+        int chunk[8];
+        int last = -1;
+        while (!done) {
+            if (ring.get(1, chunk, 8)) {
+                for (int v: chunk) {
+                    if (v <= last) slowInOrder = false;
+                    last = v;
+                }
+                slowReadCount += 8;
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    std::thread fastReader([&]() {
+        int chunk[4];
+        int expected = 0;
+        while (expected < totalCount) {
+            if (!ring.get(0, chunk, 4)) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (int v: chunk) {
+                if (v != expected++) fastInOrder = false;
+            }
+        }
+    });
+
+    int chunk[4];
+    int next = 0;
+    while (next < totalCount) {
+        for (int &v: chunk) v = next++;
+        while (!ring.push(chunk, 4)) std::this_thread::yield();
+    }
+    fastReader.join();
+    done = true;
+    slowReader.join();
+
+    REQUIRE(slowInOrder);
+    REQUIRE(fastInOrder);
+    REQUIRE(slowReadCount + ring.droppedFrames(1) + ring.size(1) == (size_t) totalCount);
+}
+
+TEST_CASE("Ring fill stats", "[ring_buffer]") {
+    RingFillStats stats(160);
+    REQUIRE(stats.snapshot().samples == 0);
+    REQUIRE(stats.snapshot().low == 0);
+
+    stats.record(5);
+    stats.record(25);
+    stats.record(159);
+    stats.record(400);
+
+    auto s = stats.snapshot();
+    REQUIRE(s.samples == 4);
+    REQUIRE(s.low == 5);
+    REQUIRE(s.high == 400);
+    REQUIRE(s.mean() == Approx((5 + 25 + 159 + 400) / 4.0));
+    REQUIRE(s.histogram[0] == 1);
+    REQUIRE(s.histogram[2] == 1);
+    REQUIRE(s.histogram[15] == 2);
+    REQUIRE(stats.bucketStart(2) == 20);
+
+    stats.reset();
+    s = stats.snapshot();
+    REQUIRE(s.samples == 0);
+    REQUIRE(s.high == 0);
+    REQUIRE(s.histogram[15] == 0);
+
+    // Reader and writer threads record concurrently.
+    std::thread other([&stats]() {
+        for (size_t i = 0; i < 10000; i++) stats.record(i % 200);
+    });
+    for (size_t i = 0; i < 10000; i++) stats.record(i % 100 + 10);
+    other.join();
+    s = stats.snapshot();
+    REQUIRE(s.samples == 20000);
+    REQUIRE(s.low == 0);
+    REQUIRE(s.high == 199);
+}
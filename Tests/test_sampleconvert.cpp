@@ -0,0 +1,639 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "catch.hpp"
+#include "../Source/utils/SampleConvert.h"
+#include "../Source/utils/RingBuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Runs `check` once per SIMD level this CPU supports.
+template<typename F>
+static void forEachSimdLevel(F check) {
+    auto saved = simdLevel();
+    for (auto level: {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+        if ((int) level > (int) detectSimdLevel()) break;
+        setSimdLevel(level);
+        INFO("simd level " << simdLevelName(level));
+        check();
+    }
+    setSimdLevel(saved);
+}
+
+static std::vector<int32_t> randomSamples(size_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<int32_t> samples(count);
+    for (auto &s: samples) s = (int32_t) rng();
+    samples[0] = INT32_MIN;
+    samples[count - 1] = INT32_MAX;
+    return samples;
+}
+
+TEST_CASE("Interleave kernels match scalar interleaving", "[sample_convert]") {
+    forEachSimdLevel([]() {
+        for (size_t channels: {1, 2, 3, 6, 8}) {
+            // Odd sizes and offsets cover the scalar tails after vector loops.
+            for (size_t frames: {0, 1, 7, 64, 67, 1024}) {
+                std::vector<std::vector<int32_t>> planar(channels);
+                for (size_t ch = 0; ch < channels; ch++) {
+                    planar[ch] = randomSamples(frames + 5, (uint32_t) (ch * 100 + frames + 1));
+                }
+                for (size_t offset: {0, 3}) {
+                    size_t count = frames + 5 - offset;
+                    std::vector<int32_t> out(count * channels + 1, 0x7777);
+                    interleaveInt32(planar, offset, count, out.data());
+                    bool same = true;
+                    for (size_t i = 0; i < count; i++) {
+                        for (size_t ch = 0; ch < channels; ch++) {
+                            if (out[i * channels + ch] != planar[ch][offset + i]) same = false;
+                        }
+                    }
+                    INFO(channels << " channels, " << count << " frames from " << offset);
+                    REQUIRE(same);
+                    REQUIRE(out.back() == 0x7777);
+                }
+            }
+        }
+    });
+}
+
+TEST_CASE("Output format kernels match scalar conversion", "[sample_convert]") {
+    forEachSimdLevel([]() {
+        for (size_t count: {1, 5, 16, 31, 512, 2049}) {
+            auto in = randomSamples(count, (uint32_t) count);
+
+            std::vector<int16_t> out16(count + 1, 0x1234);
+            convertInt32ToInt16(in.data(), out16.data(), count);
+            bool same16 = true;
+            for (size_t i = 0; i < count; i++) {
+                if (out16[i] != (int16_t) (in[i] >> 16)) same16 = false;
+            }
+            REQUIRE(same16);
+            REQUIRE(out16.back() == 0x1234);
+
+            std::vector<int32_t> out24(count + 1, 0x1234);
+            convertInt32ToInt24In32(in.data(), out24.data(), count);
+            bool same24 = true;
+            for (size_t i = 0; i < count; i++) {
+                if (out24[i] != (int32_t) ((uint32_t) in[i] & 0xFFFFFF00u)) same24 = false;
+            }
+            REQUIRE(same24);
+            REQUIRE(out24.back() == 0x1234);
+        }
+    });
+}
+
+TEST_CASE("Ringbuffer pushPlanar interleaves int32 with the SIMD kernels", "[sample_convert]") {
+    forEachSimdLevel([]() {
+        RingBuffer<int32_t> rb(37, 8);
+        std::vector<std::vector<int32_t>> planar(8, std::vector<int32_t>(20));
+        int32_t next = 0;
+        std::vector<int32_t> out(20 * 8);
+        // Wraps around the end of the 37-frame storage on the second push.
+        for (int round = 0; round < 4; round++) {
+            for (size_t i = 0; i < 20; i++) {
+                for (size_t ch = 0; ch < 8; ch++) planar[ch][i] = next + (int32_t) (i * 8 + ch);
+            }
+            REQUIRE(rb.pushPlanar(planar));
+            REQUIRE(rb.get(out.data(), 20));
+            for (size_t i = 0; i < out.size(); i++) REQUIRE(out[i] == next + (int32_t) i);
+            next += 160;
+        }
+    });
+}
+
+TEST_CASE("ASIO ingest kernels match the scalar headroom scaling", "[sample_convert]") {
+    forEachSimdLevel([]() {
+        for (size_t count: {1, 3, 4, 17, 64, 1000}) {
+            auto in = randomSamples(count, (uint32_t) count + 7);
+            std::vector<int32_t> out(count + 1, 0x1234);
+            convertAsioInt32ToMix(in.data(), out.data(), count);
+            bool same = true;
+            for (size_t i = 0; i < count; i++) {
+                int32_t sample = in[i];
+                sample >>= 8;
+                sample -= (sample >> 4);
+                if (out[i] != sample) same = false;
+            }
+            REQUIRE(same);
+            REQUIRE(out.back() == 0x1234);
+        }
+    });
+}
+
+TEST_CASE("ASIO ingest gives the same mix for every sample type", "[sample_convert]") {
+    forEachSimdLevel([]() {
+        for (size_t count: {1, 3, 8, 11, 17, 64, 1000}) {
+            std::vector<int32_t> expected(count);
+            std::vector<float> expectedFloat(count);
+
+            // Each format holds `in` truncated to its precision.
+            {  // int24
+                auto in = randomSamples(count, (uint32_t) count + 13);
+                std::vector<uint8_t> packed(count * 3);
+                for (size_t i = 0; i < count; i++) {
+                    in[i] &= ~0xFF;
+                    auto u = (uint32_t) in[i] >> 8;
+                    packed[i * 3] = (uint8_t) u;
+                    packed[i * 3 + 1] = (uint8_t) (u >> 8);
+                    packed[i * 3 + 2] = (uint8_t) (u >> 16);
+                }
+                convertAsioInt32ToMix(in.data(), expected.data(), count);
+                convertAsioInt32ToMixFloat(in.data(), expectedFloat.data(), count);
+                std::vector<int32_t> out(count);
+                std::vector<float> outFloat(count);
+                convertAsioToMix(AsioSampleFormat::Int24LSB, packed.data(), out.data(), count);
+                convertAsioToMixFloat(AsioSampleFormat::Int24LSB, packed.data(), outFloat.data(), count);
+                REQUIRE(out == expected);
+                REQUIRE(outFloat == expectedFloat);
+            }
+            {  // int16
+                auto in = randomSamples(count, (uint32_t) count + 13);
+                std::vector<int16_t> samples(count);
+                for (size_t i = 0; i < count; i++) {
+                    in[i] &= ~0xFFFF;
+                    samples[i] = (int16_t) (in[i] >> 16);
+                }
+                convertAsioInt32ToMix(in.data(), expected.data(), count);
+                convertAsioInt32ToMixFloat(in.data(), expectedFloat.data(), count);
+                std::vector<int32_t> out(count);
+                std::vector<float> outFloat(count);
+                convertAsioToMix(AsioSampleFormat::Int16LSB, samples.data(), out.data(), count);
+                convertAsioToMixFloat(AsioSampleFormat::Int16LSB, samples.data(), outFloat.data(), count);
+                REQUIRE(out == expected);
+                REQUIRE(outFloat == expectedFloat);
+            }
+            {  // float32
+                auto in = randomSamples(count, (uint32_t) count + 13);
+                std::vector<float> samples(count);
+                for (size_t i = 0; i < count; i++) {
+                    in[i] &= ~0xFF;
+                    samples[i] = (float) (in[i] >> 8) / (1 << 23);
+                }
+                convertAsioInt32ToMix(in.data(), expected.data(), count);
+                convertAsioInt32ToMixFloat(in.data(), expectedFloat.data(), count);
+                std::vector<int32_t> out(count);
+                std::vector<float> outFloat(count);
+                convertAsioToMix(AsioSampleFormat::Float32LSB, samples.data(), out.data(), count);
+                convertAsioToMixFloat(AsioSampleFormat::Float32LSB, samples.data(), outFloat.data(), count);
+                REQUIRE(out == expected);
+                REQUIRE(outFloat == expectedFloat);
+            }
+        }
+    });
+}
+
+TEST_CASE("Float ASIO input beyond full scale is clamped on the integer mix bus", "[sample_convert]") {
+    forEachSimdLevel([]() {
+        std::vector<float> in = {1000.0f, -1000.0f, INFINITY, -INFINITY, 2.0f, -2.0f, 0.5f, 0.0f, 1000.0f};
+        std::vector<int32_t> out(in.size());
+        convertAsioToMix(AsioSampleFormat::Float32LSB, in.data(), out.data(), in.size());
+        const int32_t limit = (1 << 30) - (1 << 26);
+        REQUIRE(out == std::vector<int32_t>{limit, -limit, limit, -limit, 15 << 20, -(15 << 20), 15 << 18, 0, limit});
+    });
+}
+
+TEST_CASE("NaN from a float ASIO host becomes silence on both mix buses", "[sample_convert]") {
+    forEachSimdLevel([]() {
+        // Spread over SIMD bodies and tails.
+        std::vector<float> in(19, 0.5f);
+        for (size_t i: {0, 6, 9, 13, 18}) in[i] = NAN;
+        in[7] = -NAN;
+        std::vector<int32_t> out(in.size());
+        std::vector<float> outFloat(in.size());
+        convertAsioToMix(AsioSampleFormat::Float32LSB, in.data(), out.data(), in.size());
+        convertAsioToMixFloat(AsioSampleFormat::Float32LSB, in.data(), outFloat.data(), in.size());
+        for (size_t i = 0; i < in.size(); i++) {
+            INFO("index " << i);
+            REQUIRE(out[i] == (std::isnan(in[i]) ? 0 : 15 << 18));
+            REQUIRE(outFloat[i] == (std::isnan(in[i]) ? 0.0f : 0.5f * 0.9375f));
+        }
+    });
+}
+
+// The clipper this replaced, one sample at a time. Its exponent used integer
+// division, so its curve is a staircase with one step per kSoftClipPadding.
+static int32_t legacyCompress(int32_t sample) {
+    const int32_t overflowPreventer = 5;
+    const int32_t compressPadding = (1 << 19) - overflowPreventer;
+    const int32_t compressionThresholdHigh =
+            (1 << 23) - compressPadding - overflowPreventer;
+    const int32_t compressionThresholdLow = -compressionThresholdHigh;
+
+    int32_t o;
+    if (sample > compressionThresholdHigh) {
+        auto overflow = sample - compressionThresholdHigh;
+        o = compressionThresholdHigh + (int32_t) round(
+                compressPadding * (2 / (1 + exp(-overflow / compressPadding)) - 1));
+    } else if (sample < compressionThresholdLow) {
+        auto overflow = sample - compressionThresholdLow;
+        o = compressionThresholdLow + (int32_t) round(
+                compressPadding * (2 / (1 + exp(-overflow / compressPadding)) - 1));
+    } else {
+        o = sample;
+    }
+    return o << 8;
+}
+
+// The curve the legacy code meant to compute.
+static double continuousCompress(int32_t sample) {
+    double a = std::abs((double) sample);
+    double overflow = std::max(a - kSoftClipThreshold, 0.0);
+    double r = std::min(a, (double) kSoftClipThreshold) +
+               kSoftClipPadding * std::tanh(overflow / (2.0 * kSoftClipPadding));
+    return sample < 0 ? -r : r;
+}
+
+static std::vector<int32_t> softClipInputs() {
+    std::vector<int32_t> in;
+    for (int64_t s = -(1 << 26); s <= (1 << 26); s += 997) in.push_back((int32_t) s);
+    for (int32_t s: {0, 1, -1, kSoftClipThreshold, kSoftClipThreshold + 1, -kSoftClipThreshold,
+                     -kSoftClipThreshold - 1, 1 << 30, -(1 << 30), INT32_MAX, INT32_MIN, INT32_MIN + 1}) {
+        in.push_back(s);
+    }
+    return in;
+}
+
+TEST_CASE("Soft clipper follows the compression curve", "[sample_convert]") {
+    auto in = softClipInputs();
+    forEachSimdLevel([&in]() {
+        auto out = in;
+        softClipInt24ToInt32(out.data(), out.size());
+
+        bool passThrough = true, accurate = true, withinLegacySteps = true, bounded = true;
+        for (size_t i = 0; i < in.size(); i++) {
+            int32_t s = in[i];
+            int32_t o = out[i] >> 8;
+            if ((out[i] & 0xFF) != 0) bounded = false;
+            if (o >= (1 << 23) || o < -(1 << 23)) bounded = false;
+            if (std::abs((int64_t) s) <= kSoftClipThreshold) {
+                if (out[i] != (int32_t) ((uint32_t) s << 8)) passThrough = false;
+                continue;
+            }
+            if (std::abs(o - continuousCompress(s)) > 1.0) accurate = false;
+
+            // Between the legacy stair below and the one above.
+            if (std::abs((int64_t) s) < (1 << 28)) {
+                int32_t step = s > 0 ? kSoftClipPadding : -kSoftClipPadding;
+                int32_t lower = legacyCompress(s) >> 8, upper = legacyCompress(s + step) >> 8;
+                if (s < 0) std::swap(lower, upper);
+                if (o < lower - 1 || o > upper + 1) withinLegacySteps = false;
+            }
+        }
+        REQUIRE(passThrough);
+        REQUIRE(accurate);
+        REQUIRE(withinLegacySteps);
+        REQUIRE(bounded);
+
+        // Monotonic across the whole tested range
+        bool monotonic = true;
+        for (size_t i = 1; in[i] > in[i - 1]; i++) {
+            if (out[i] < out[i - 1]) monotonic = false;
+        }
+        REQUIRE(monotonic);
+    });
+}
+
+TEST_CASE("Soft clipper kernels are bit-identical", "[sample_convert]") {
+    auto in = softClipInputs();
+    auto saved = simdLevel();
+    setSimdLevel(SimdLevel::Scalar);
+    auto expected = in;
+    softClipInt24ToInt32(expected.data(), expected.size());
+    setSimdLevel(saved);
+
+    forEachSimdLevel([&]() {
+        // Odd lengths cover the tails.
+        for (size_t count: {in.size(), in.size() - 3, (size_t) 7}) {
+            auto out = in;
+            softClipInt24ToInt32(out.data(), count);
+            bool same = true;
+            for (size_t i = 0; i < count; i++) {
+                if (out[i] != expected[i]) same = false;
+            }
+            REQUIRE(same);
+            if (count < in.size()) REQUIRE(out[count] == in[count]);
+        }
+    });
+}
+
+TEST_CASE("Float conversion kernels match scalar scaling", "[sample_convert]") {
+    forEachSimdLevel([]() {
+        for (size_t count: {1, 3, 4, 17, 64, 1000}) {
+            auto in = randomSamples(count, (uint32_t) count + 11);
+            std::vector<float> toFloat(count + 1, 2.0f), mix(count + 1, 2.0f);
+            convertInt32ToFloat(in.data(), toFloat.data(), count);
+            convertAsioInt32ToMixFloat(in.data(), mix.data(), count);
+            bool same = true;
+            for (size_t i = 0; i < count; i++) {
+                if (toFloat[i] != (float) in[i] / 2147483648.0f) same = false;
+                if (mix[i] != (float) in[i] * (0.9375f / 2147483648.0f)) same = false;
+            }
+            REQUIRE(same);
+            REQUIRE(toFloat.back() == 2.0f);
+            REQUIRE(mix.back() == 2.0f);
+        }
+    });
+}
+
+// softClipInputs on the float mix bus scale, plus values the integer bus can't hold.
+static std::vector<float> softClipFloatInputs() {
+    std::vector<float> in;
+    for (auto s: softClipInputs()) in.push_back((float) s / (1 << 23));
+    for (float s: {1e30f, -1e30f, INFINITY, -INFINITY}) in.push_back(s);
+    return in;
+}
+
+TEST_CASE("Float soft clipper follows the compression curve", "[sample_convert]") {
+    auto in = softClipFloatInputs();
+    forEachSimdLevel([&in]() {
+        std::vector<int32_t> out(in.size());
+        softClipFloatToInt32(in.data(), out.data(), in.size());
+
+        bool passThrough = true, accurate = true;
+        for (size_t i = 0; i < in.size(); i++) {
+            double s = (double) in[i] * (1 << 23);
+            if (std::abs(s) <= kSoftClipThreshold) {
+                if (out[i] != (int32_t) (s * 256)) passThrough = false;
+                continue;
+            }
+            auto clamped = (int32_t) std::max(std::min(s, 2147483647.0), -2147483648.0);
+            if (std::abs(out[i] / 256.0 - continuousCompress(clamped)) > 1.0) accurate = false;
+        }
+        REQUIRE(passThrough);
+        REQUIRE(accurate);
+
+        bool monotonic = true;
+        for (size_t i = 1; in[i] > in[i - 1]; i++) {
+            if (out[i] < out[i - 1]) monotonic = false;
+        }
+        REQUIRE(monotonic);
+    });
+}
+
+TEST_CASE("Float soft clipper kernels are bit-identical", "[sample_convert]") {
+    auto in = softClipFloatInputs();
+    auto saved = simdLevel();
+    setSimdLevel(SimdLevel::Scalar);
+    std::vector<int32_t> expected(in.size());
+    softClipFloatToInt32(in.data(), expected.data(), in.size());
+    setSimdLevel(saved);
+
+    forEachSimdLevel([&]() {
+        for (size_t count: {in.size(), in.size() - 3, (size_t) 7}) {
+            std::vector<int32_t> out(in.size(), 0x1234);
+            softClipFloatToInt32(in.data(), out.data(), count);
+            bool same = true;
+            for (size_t i = 0; i < count; i++) {
+                if (out[i] != expected[i]) same = false;
+            }
+            REQUIRE(same);
+            if (count < in.size()) REQUIRE(out[count] == 0x1234);
+        }
+    });
+}
+
+TEST_CASE("Float soft clipper maps NaN to the threshold and Inf to full scale", "[sample_convert]") {
+    // Spread over SIMD bodies and tails.
+    std::vector<float> in(19, 0.5f);
+    for (size_t i: {0, 5, 10, 17}) in[i] = NAN;
+    for (size_t i: {1, 11, 18}) in[i] = -NAN;
+    in[3] = INFINITY;
+    in[12] = -INFINITY;
+    std::vector<int32_t> loud(2);
+    const float loudIn[] = {1e30f, -1e30f};
+
+    forEachSimdLevel([&]() {
+        std::vector<int32_t> out(in.size());
+        softClipFloatToInt32(in.data(), out.data(), in.size());
+        softClipFloatToInt32(loudIn, loud.data(), 2);
+        for (size_t i = 0; i < in.size(); i++) {
+            INFO("index " << i);
+            if (std::isnan(in[i])) {
+                REQUIRE(out[i] == (std::signbit(in[i]) ? -1 : 1) * kSoftClipThreshold * 256);
+            } else if (std::isinf(in[i])) {
+                REQUIRE(out[i] == loud[in[i] < 0]);
+            } else {
+                REQUIRE(out[i] == (int32_t) (0.5 * 2147483648.0));
+            }
+        }
+    });
+}
+
+TEST_CASE("Interpolated peak kernels are bit-identical", "[sample_convert]") {
+    std::mt19937 rng(21);
+    std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+    std::vector<float> in(1000 + 8);
+    for (auto &s: in) s = dist(rng);
+    std::vector<float> initial(1000);
+    for (auto &s: initial) s = std::fabs(dist(rng)) * 0.5f;
+
+    auto saved = simdLevel();
+    setSimdLevel(SimdLevel::Scalar);
+    auto expected = initial;
+    interpolatedPeak(in.data() + 4, expected.data(), expected.size());
+    setSimdLevel(saved);
+
+    bool covers = true;
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (expected[i] < std::fabs(in[i + 4]) || expected[i] < initial[i]) covers = false;
+    }
+    REQUIRE(covers);
+
+    forEachSimdLevel([&]() {
+        for (size_t count: {initial.size(), initial.size() - 3, (size_t) 7}) {
+            auto peak = initial;
+            interpolatedPeak(in.data() + 4, peak.data(), count);
+            bool same = true;
+            for (size_t i = 0; i < count; i++) {
+                if (peak[i] != expected[i]) same = false;
+            }
+            REQUIRE(same);
+            if (count < peak.size()) REQUIRE(peak[count] == initial[count]);
+        }
+    });
+}
+
+TEST_CASE("Dither kernels are bit-identical", "[sample_convert]") {
+    auto in = randomSamples(2000, 31);
+    // Uneven chunks cover the tails and carrying the state across calls.
+    const size_t chunks[] = {1000, 37, 5, 958};
+
+    auto saved = simdLevel();
+    setSimdLevel(SimdLevel::Scalar);
+    std::vector<int16_t> expected(in.size());
+    DitherState expectedState(2, 9);
+    size_t pos = 0;
+    for (auto n: chunks) {
+        convertInt32ToInt16Dither(in.data() + pos, expected.data() + pos, n, &expectedState);
+        pos += n;
+    }
+    setSimdLevel(saved);
+
+    forEachSimdLevel([&]() {
+        std::vector<int16_t> out(in.size() + 1, 0x1234);
+        DitherState state(2, 9);
+        size_t pos = 0;
+        for (auto n: chunks) {
+            convertInt32ToInt16Dither(in.data() + pos, out.data() + pos, n, &state);
+            pos += n;
+        }
+        REQUIRE(std::equal(expected.begin(), expected.end(), out.begin()));
+        REQUIRE(out.back() == 0x1234);
+        REQUIRE(std::equal(std::begin(state.rng), std::end(state.rng), std::begin(expectedState.rng)));
+    });
+}
+
+TEST_CASE("TPDF dither is unbiased and stays within 1.5 LSB", "[sample_convert]") {
+    forEachSimdLevel([]() {
+        for (double value: {0.0, 12345.3, -7.75, 32766.5}) {
+            const size_t count = 1 << 16;
+            std::vector<int32_t> in(count, (int32_t) std::lround(value * 65536));
+            std::vector<int16_t> out(count);
+            DitherState state(2, 3);
+            convertInt32ToInt16Dither(in.data(), out.data(), count, &state);
+
+            double sum = 0;
+            bool inRange = true;
+            for (auto s: out) {
+                sum += s;
+                if (std::fabs(s - value) > 1.5) inRange = false;
+            }
+            INFO("value " << value);
+            REQUIRE(inRange);
+            REQUIRE(std::fabs(sum / count - value) < 0.02);
+        }
+
+        int32_t extremes[] = {INT32_MAX, INT32_MIN, INT32_MAX, INT32_MIN, INT32_MAX, INT32_MIN, INT32_MAX, INT32_MIN,
+                              INT32_MAX, INT32_MIN};
+        int16_t out[10];
+        DitherState state(2, 3);
+        convertInt32ToInt16Dither(extremes, out, 10, &state);
+        for (size_t i = 0; i < 10; i++) {
+            REQUIRE(std::abs(out[i] - (extremes[i] >> 16)) <= 1);
+        }
+    });
+}
+
+TEST_CASE("Noise shaped dither keeps the accumulated error bounded", "[sample_convert]") {
+    const size_t channels = 2, frames = 10000;
+    std::mt19937 rng(17);
+    std::vector<int32_t> in(frames * channels);
+    for (auto &s: in) s = (int32_t) (rng() >> 2) - (1 << 29);
+
+    std::vector<int16_t> out(in.size());
+    DitherState state(channels, 5);
+    convertInt32ToInt16ShapedDither(in.data(), out.data(), in.size(), &state);
+
+    // First-order error feedback: the output error is the difference of two
+    // successive rounding errors, so its running sum can't drift.
+    double sums[channels] = {};
+    double worst = 0;
+    for (size_t i = 0; i < frames; i++) {
+        for (size_t ch = 0; ch < channels; ch++) {
+            sums[ch] += out[i * channels + ch] - in[i * channels + ch] / 65536.0;
+            worst = std::max(worst, std::fabs(sums[ch]));
+        }
+    }
+    REQUIRE(worst < 2.0);
+
+    // Frame-aligned chunks give the same output as one call.
+    std::vector<int16_t> chunked(in.size());
+    DitherState chunkedState(channels, 5);
+    convertInt32ToInt16ShapedDither(in.data(), chunked.data(), 74, &chunkedState);
+    convertInt32ToInt16ShapedDither(in.data() + 74, chunked.data() + 74, in.size() - 74, &chunkedState);
+    REQUIRE(chunked == out);
+}
+
+TEST_CASE("Gain kernels are bit-identical and saturate", "[sample_convert]") {
+    const size_t channels = 3, count = 999;
+    auto in = randomSamples(count, 41);
+    // Constant gains, including unity, cut, boost into saturation and silence; and ramps.
+    const std::pair<float, float> gains[] = {{1.0f, 0.0f}, {0.5f, 0.0f}, {3.5f, 0.0f}, {0.0f, 0.0f},
+                                             {1.0f, -0.003f}, {0.1f, 0.004f}};
+
+    for (auto [gain, step]: gains) {
+        INFO("gain " << gain << " step " << step);
+        auto saved = simdLevel();
+        setSimdLevel(SimdLevel::Scalar);
+        std::vector<int16_t> expected16(count), expectedDither(count);
+        std::vector<int32_t> expected24(count), expected32(count);
+        std::vector<float> expectedFloat(count);
+        DitherState expectedState(channels, 2);
+        convertInt32ToInt16Gain(in.data(), expected16.data(), count, channels, gain, step);
+        convertInt32ToInt16DitherGain(in.data(), expectedDither.data(), count, channels, gain, step, &expectedState);
+        convertInt32ToInt24In32Gain(in.data(), expected24.data(), count, channels, gain, step);
+        convertInt32ToInt32Gain(in.data(), expected32.data(), count, channels, gain, step);
+        convertInt32ToFloatGain(in.data(), expectedFloat.data(), count, channels, gain, step);
+        setSimdLevel(saved);
+
+        // Frame f gets gain + f * step on every channel, then rounds and saturates.
+        bool scaled = true;
+        for (size_t i = 0; i < count; i++) {
+            double g = gain + (float) (i / channels) * step;
+            double v = std::clamp((double) in[i] * g, -2147483648.0, 2147483520.0);
+            if (std::fabs(expected32[i] - v) > std::max(1.0, std::fabs(v) * 1e-6)) scaled = false;
+            if (expected16[i] != (int16_t) (expected32[i] >> 16)) scaled = false;
+            if (expected24[i] != (int32_t) ((uint32_t) expected32[i] & 0xFFFFFF00u)) scaled = false;
+        }
+        REQUIRE(scaled);
+
+        forEachSimdLevel([&]() {
+            std::vector<int16_t> out16(count), outDither(count);
+            std::vector<int32_t> out24(count), out32(count);
+            std::vector<float> outFloat(count);
+            DitherState state(channels, 2);
+            convertInt32ToInt16Gain(in.data(), out16.data(), count, channels, gain, step);
+            convertInt32ToInt16DitherGain(in.data(), outDither.data(), count, channels, gain, step, &state);
+            convertInt32ToInt24In32Gain(in.data(), out24.data(), count, channels, gain, step);
+            convertInt32ToInt32Gain(in.data(), out32.data(), count, channels, gain, step);
+            convertInt32ToFloatGain(in.data(), outFloat.data(), count, channels, gain, step);
+            REQUIRE(out16 == expected16);
+            REQUIRE(outDither == expectedDither);
+            REQUIRE(out24 == expected24);
+            REQUIRE(out32 == expected32);
+            REQUIRE(outFloat == expectedFloat);
+        });
+    }
+}
+
+TEST_CASE("Mix add kernels add sample by sample and wrap", "[sample_convert]") {
+    const size_t count = 1003;
+    auto in = randomSamples(count, 51);
+    auto bus = randomSamples(count + 1, 52);
+    std::vector<float> inFloat(count), busFloat(count + 1);
+    for (size_t i = 0; i < count; i++) inFloat[i] = (float) in[i] * 0x1p-31f;
+    for (size_t i = 0; i <= count; i++) busFloat[i] = (float) bus[i] * 0x1p-31f;
+
+    forEachSimdLevel([&]() {
+        auto out = bus;
+        auto outFloat = busFloat;
+        mixAddInt32(in.data(), out.data(), count);
+        mixAddFloat(inFloat.data(), outFloat.data(), count);
+        bool same = true;
+        for (size_t i = 0; i < count; i++) {
+            if (out[i] != (int32_t) ((uint32_t) bus[i] + (uint32_t) in[i])) same = false;
+            if (outFloat[i] != busFloat[i] + inFloat[i]) same = false;
+        }
+        REQUIRE(same);
+        REQUIRE(out[count] == bus[count]);
+        REQUIRE(outFloat[count] == busFloat[count]);
+    });
+}
@@ -0,0 +1,257 @@
+// Copyright (C) 2023 Hyunwoo Park
+//
+// This file is part of trgkASIO.
+//
+// trgkASIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// trgkASIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with trgkASIO.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Stress test for the output transport: RunningState::threadProc pushing
+// into the shared BroadcastRingBuffer, and one WASAPIOutputEvent::LoadData
+// per device reading from it, each on its own thread with random block
+// sizes and timings.
+//
+// Environment variables:
+// - TRGKASIO_STRESS_BLOCKS: blocks pushed per run (default 1000000)
+// - TRGKASIO_STRESS_SEED: random seed (default 1)
+//
+// Build with -DTRGKASIO_SANITIZE_THREAD=ON to run under ThreadSanitizer.
+
+#include "catch.hpp"
+#include "../Source/utils/BroadcastRingBuffer.h"
+#include <atomic>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static size_t envOr(const char *name, size_t defaultValue) {
+    auto value = getenv(name);
+    return value ? std::strtoull(value, nullptr, 10) : defaultValue;
+}
+
+// Every sample encodes its position in the stream, so readers can check
+// each one without sharing state with the writer.
+static int32_t sampleAt(size_t frame, size_t channel, size_t channelCount) {
+    return (int32_t) (uint32_t) (frame * channelCount + channel);
+}
+
+static void randomPause(std::mt19937 &rng) {
+    auto r = rng() % 64;
+    if (r == 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(rng() % 200));
+    } else if (r < 8) {
+        std::this_thread::yield();
+    } else if (r < 16) {
+        for (volatile int i = 0, n = (int) (rng() % 1000); i < n; i++) {}
+    }
+}
+
+namespace {
+    struct ReaderResult {
+        size_t framesRead = 0;
+        size_t reads = 0;
+        size_t underruns = 0;
+        bool ok = true;
+        std::string error;
+
+        void fail(const std::string &msg) {
+            if (ok) error = msg;
+            ok = false;
+        }
+    };
+}
+
+/**
+ * Reads like LoadData: ask for a random number of frames, check them in
+ * place in the spans, and commit. Lossless readers must see every frame in
+ * order; lossy ones may skip frames but never go back or tear a frame.
+ */
+static void runReader(BroadcastRingBuffer<int32_t> &ring, size_t reader, bool lossless,
+                      const std::atomic<bool> &writerDone, size_t totalFrames, uint32_t seed,
+                      ReaderResult &result) {
+    std::mt19937 rng(seed);
+    auto channelCount = ring.frameSize();
+    size_t expected = 0;
+
+    while (expected < totalFrames) {
+        size_t request = 1 + rng() % 1024;
+
+        auto spans = ring.readSpans(reader);
+        if (spans.size() == 0 || (lossless && spans.size() < std::min(request, totalFrames - expected))) {
+            ring.commitRead(reader, 0);
+            result.underruns++;
+            if (!lossless && writerDone.load(std::memory_order_acquire) && ring.size(reader) == 0) break;
+            randomPause(rng);
+            continue;
+        }
+
+        size_t n = std::min(request, spans.size());
+        auto frameOf = [&](size_t i) -> const int32_t * {
+            return i < spans.firstSize ? spans.first + i * channelCount
+                                       : spans.second + (i - spans.firstSize) * channelCount;
+        };
+
+        size_t first = expected;
+        if (!lossless) {
+            // Frames dropped by the writer show up as a jump forward.
+            first = (uint32_t) frameOf(0)[0] / channelCount;
+            if (first < expected) {
+                result.fail("Lossy reader went backwards at frame " + std::to_string(expected));
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            auto frame = frameOf(i);
+            for (size_t ch = 0; ch < channelCount; ch++) {
+                if (frame[ch] != sampleAt(first + i, ch, channelCount)) {
+                    result.fail("Reader " + std::to_string(reader) + " mismatch at frame " +
+                                std::to_string(first + i) + " channel " + std::to_string(ch));
+                }
+            }
+        }
+        ring.commitRead(reader, n);
+        if (!result.ok) return;
+
+        expected = first + n;
+        result.framesRead += n;
+        result.reads++;
+        randomPause(rng);
+    }
+}
+
+TEST_CASE("Output transport survives concurrent randomized pushes and reads", "[ring_buffer][stress]") {
+    const size_t blockCount = envOr("TRGKASIO_STRESS_BLOCKS", 1000000);
+    const auto seed = (uint32_t) envOr("TRGKASIO_STRESS_SEED", 1);
+    const size_t channelCount = 2;
+    auto storage = GENERATE(RingBufferStorage::Heap, RingBufferStorage::Mirrored);
+    INFO("seed " << seed << ", mirrored " << (storage == RingBufferStorage::Mirrored));
+
+    // Same shapes as RunningState: lossless outputs bound the writer,
+    // lossy ones get pushed forward.
+    std::vector<RingReaderConfig> configs = {
+            {4096, RingOverflowPolicy::DropNewest},
+            {2048, RingOverflowPolicy::DropNewest},
+            {1024, RingOverflowPolicy::DropOldest},
+            {1024, RingOverflowPolicy::Trim, 300},
+    };
+    BroadcastRingBuffer<int32_t> ring(channelCount, configs, storage);
+
+    // Block sizes are decided up front, so readers know where the stream ends.
+    std::mt19937 rng(seed);
+    std::vector<size_t> blockSizes(blockCount);
+    size_t totalFrames = 0;
+    for (auto &size: blockSizes) {
+        size = 1 + rng() % 512;
+        totalFrames += size;
+    }
+
+    std::atomic<bool> writerDone{false};
+    std::vector<ReaderResult> results(configs.size());
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < configs.size(); i++) {
+        bool lossless = configs[i].policy == RingOverflowPolicy::DropNewest;
+        readers.emplace_back(runReader, std::ref(ring), i, lossless, std::cref(writerDone),
+                             totalFrames, seed + 1 + (uint32_t) i, std::ref(results[i]));
+    }
+
+    std::vector<std::vector<int32_t>> block(channelCount);
+    size_t frame = 0;
+    size_t writeRetries = 0;
+    for (auto size: blockSizes) {
+        for (size_t ch = 0; ch < channelCount; ch++) {
+            block[ch].resize(size);
+            for (size_t i = 0; i < size; i++) block[ch][i] = sampleAt(frame + i, ch, channelCount);
+        }
+        // RunningState drops the block on overflow. Retry instead, so the
+        // lossless readers can check the whole stream.
+        while (!ring.pushPlanar(block)) {
+            writeRetries++;
+            std::this_thread::yield();
+        }
+        frame += size;
+        randomPause(rng);
+    }
+    writerDone.store(true, std::memory_order_release);
+    for (auto &t: readers) t.join();
+
+    for (size_t i = 0; i < configs.size(); i++) {
+        INFO("reader " << i << ": " << results[i].error);
+        REQUIRE(results[i].ok);
+        if (configs[i].policy == RingOverflowPolicy::DropNewest) {
+            REQUIRE(results[i].framesRead == totalFrames);
+            REQUIRE(ring.droppedFrames(i) == 0);
+        } else {
+            REQUIRE(results[i].framesRead + ring.droppedFrames(i) == totalFrames);
+        }
+        REQUIRE(ring.size(i) == 0);
+    }
+}
+
+TEST_CASE("Output transport keeps feeding readers while another one never reads", "[ring_buffer][stress]") {
+    const size_t blockCount = envOr("TRGKASIO_STRESS_BLOCKS", 1000000) / 10;
+    const auto seed = (uint32_t) envOr("TRGKASIO_STRESS_SEED", 1);
+    const size_t channelCount = 2;
+    INFO("seed " << seed);
+
+    // Reader 0 is an output whose play thread died: it never reads.
+    std::vector<RingReaderConfig> configs = {
+            {4096, RingOverflowPolicy::DropNewest, 0, 8},
+            {2048, RingOverflowPolicy::DropNewest},
+            {1024, RingOverflowPolicy::DropOldest},
+    };
+    BroadcastRingBuffer<int32_t> ring(channelCount, configs);
+
+    std::mt19937 rng(seed);
+    std::vector<size_t> blockSizes(blockCount);
+    size_t totalFrames = 0;
+    for (auto &size: blockSizes) {
+        size = 1 + rng() % 512;
+        totalFrames += size;
+    }
+
+    std::atomic<bool> writerDone{false};
+    std::vector<ReaderResult> results(configs.size());
+    std::vector<std::thread> readers;
+    for (size_t i = 1; i < configs.size(); i++) {
+        bool lossless = configs[i].policy == RingOverflowPolicy::DropNewest;
+        readers.emplace_back(runReader, std::ref(ring), i, lossless, std::cref(writerDone),
+                             totalFrames, seed + 1 + (uint32_t) i, std::ref(results[i]));
+    }
+
+    std::vector<std::vector<int32_t>> block(channelCount);
+    size_t frame = 0;
+    for (auto size: blockSizes) {
+        for (size_t ch = 0; ch < channelCount; ch++) {
+            block[ch].resize(size);
+            for (size_t i = 0; i < size; i++) block[ch][i] = sampleAt(frame + i, ch, channelCount);
+        }
+        // Only reader 1 may hold the writer back; reader 0 gets detached.
+        while (!ring.pushPlanar(block)) std::this_thread::yield();
+        frame += size;
+        randomPause(rng);
+    }
+    writerDone.store(true, std::memory_order_release);
+    for (auto &t: readers) t.join();
+
+    REQUIRE(ring.isDetached(0));
+    REQUIRE(ring.size(0) <= configs[0].limit - 1);
+    REQUIRE(!ring.isDetached(1));
+    for (size_t i = 1; i < configs.size(); i++) {
+        INFO("reader " << i << ": " << results[i].error);
+        REQUIRE(results[i].ok);
+        REQUIRE(results[i].framesRead + ring.droppedFrames(i) == totalFrames);
+        REQUIRE(ring.size(i) == 0);
+    }
+    REQUIRE(results[1].framesRead == totalFrames);
+}